@@ -3,6 +3,7 @@
 
 #include <Eigen/Dense>
 #include <stan/math/torsten/PKModel/functions.hpp>
+#include <stan/math/torsten/PKModel/arena.hpp>
 #include <iostream>
 #include <algorithm>
 #include <vector>
@@ -133,7 +134,8 @@ public:
 template<typename T_time, typename T_amt, typename T_rate, typename T_ii>
 class EventHistory {
 private:
-  std::vector<Event<T_time, T_amt, T_rate, T_ii> > Events;
+  typedef Event<T_time, T_amt, T_rate, T_ii> event_type;
+  std::vector<event_type, arena_allocator<event_type> > Events;
 
 public:
   template<typename T0, typename T1, typename T2, typename T3>
@@ -271,8 +273,8 @@ public:
    * @return - modified events that account for absorption lag times
    */
   template<typename T_parameters, typename T_biovar, typename T_tlag>
-  void AddLagTimes(ModelParameterHistory<T_time, T_parameters, T_biovar,
-                   T_tlag> Parameters, int nCmt) {
+  void AddLagTimes(const ModelParameterHistory<T_time, T_parameters,
+                   T_biovar, T_tlag>& Parameters, int nCmt) {
     int nEvent = Events.size(), pSize = Parameters.get_size();
     assert((pSize = nEvent) || (pSize == 1));
 
@@ -0,0 +1,959 @@
+#ifndef STAN_MATH_TORSTEN_PKMODEL_EVENTSCHEDULE_HPP
+#define STAN_MATH_TORSTEN_PKMODEL_EVENTSCHEDULE_HPP
+
+#include <Eigen/Dense>
+#include <stan/math/torsten/PKModel/Event.hpp>
+#include <stan/math/torsten/PKModel/Rate.hpp>
+#include <stan/math/torsten/PKModel/ModelParameters.hpp>
+#include <stan/math/torsten/PKModel/pmetricsCheck.hpp>
+#include <stan/math/prim/scal/err/invalid_argument.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <utility>
+#include <iostream>
+#include <vector>
+
+namespace torsten {
+
+/**
+ * The EventSchedule class stores an event schedule after the
+ * book-keeping steps of Pred: the additional doses, the lagged
+ * doses and the ends of infusions are added to the events, the
+ * rates in each compartment are computed, and each event is
+ * mapped to the rows of the parameter arrays that apply to it.
+ *
+ * This requires the event schedule and the lag times to be fixed
+ * data. The schedule can then be compiled once, passed to the
+ * overloads of the model functions that take an EventSchedule, and
+ * reused for every evaluation of the model, for instance across
+ * iterations of a fit, or written to disk (see
+ * io/schedule_cache.hpp).
+ *
+ * A schedule is compiled for given lengths of the parameter arrays
+ * (1 or the number of events), since they determine which row of
+ * the arrays applies to each event.
+ *
+ * For each event of the augmented schedule, the class stores:
+ *    time, amt, rate, ii, evid, cmt, ss: NONMEM data items
+ *    keep: if TRUE, the predicted amount at this event is returned
+ *    theta_row, biovar_row, system_row: rows of the parameter arrays
+ *    rate_row: row of the rate table
+ *
+ * The events after the last kept event (additional doses, ends of
+ * infusions), which cannot change the predictions, are dropped.
+ * Optionally, the intervals between events shorter than a time
+ * tolerance are empty in the sweeps (see Cursor::get_interval), so
+ * that the ODE solvers do not integrate over the short intervals
+ * between events recorded a few seconds apart.
+ * A schedule without infusions (all the rates are zero) is flagged
+ * when it is compiled or read, so that Pred can skip the rates.
+ *
+ * The schedule also carries the ID of the subject it belongs to,
+ * which is passed on to a PredSink when predictions are streamed,
+ * the checkpoint interval of Pred (see set_checkpoint_interval)
+ * and the number of threads of Pred (see set_threads), which are
+ * not part of the compiled schedule.
+ *
+ * The additional doses (addl) of a dosing row are not stored one
+ * by one when the parameters are constant over the events: the
+ * periods of the train away from other events are generated from
+ * the row, without being expanded, and stored as entries which
+ * generate the times of their events on demand (see PlanTrains and
+ * FoldTrains). The accessors take the index of an event, as if the
+ * events were stored; the sweeps read the events in order with a
+ * Cursor.
+ *
+ * The schedule is split into segments at the events which
+ * overwrite the amounts in the compartments (resets, evid = 3 or 4,
+ * and steady state events with a reset, ss = 1 or 3): the
+ * predictions of a segment do not depend on the events before it.
+ */
+class EventSchedule {
+private:
+  int nCmt_, nTheta_, nBiovar_, nSystem_, nKeep_;
+  int checkpoint_;  // checkpoint interval of Pred (0: none)
+  int first_dose_;  // index of the first dose
+  int threads_;     // number of threads of Pred
+  double id_;
+  double tolerance_;  // intervals shorter than this are empty
+  bool infusions_;
+  std::vector<double> time_, amt_, rate_, ii_;
+  std::vector<int> evid_, cmt_, ss_, keep_;
+  std::vector<int> theta_row_, biovar_row_, system_row_, rate_row_;
+  std::vector<double> rates_;  // rate in each compartment, row-major
+
+  // Without trains of doses (see FoldTrains), the columns above
+  // have one row per event, and the ones below are empty. Otherwise,
+  // entry e covers the events first_[e] to first_[e + 1] - 1, in
+  // periods of width_[e] events stored in the rows column_[e] to
+  // column_[e] + width_[e] - 1. The event of row r in the jth
+  // period is at the time
+  //   ((origin_[e] + (mult_[e] + j) * step_[e]) + lag_[r])
+  //     + duration_[r]
+  // or time_[r] if step_[e] is 0.
+  std::vector<int> first_, column_, width_, mult_;
+  std::vector<double> origin_, step_, lag_, duration_;
+
+  std::vector<int> segments_;      // first event of each segment
+  std::vector<int> auc_segments_;  // same, for the AUCs
+
+  template <typename T>
+  static void WriteColumn(std::ostream& out, const std::vector<T>& x) {
+    unsigned long long size = x.size();  // NOLINT(runtime/int)
+    out.write(reinterpret_cast<const char*>(&size), sizeof(size));
+    if (size > 0)
+      out.write(reinterpret_cast<const char*>(&x[0]), size * sizeof(T));
+  }
+
+  template <typename T>
+  static const char* ReadColumn(const char* p, const char* end,
+                                std::vector<T>& x) {
+    static const char* function("EventSchedule::Read");
+    unsigned long long size;  // NOLINT(runtime/int)
+    if (p == 0 || end - p < static_cast<long>(sizeof(size)))  // NOLINT
+      stan::math::invalid_argument(function, "cached schedule", "", "",
+                                   "is truncated!");
+    std::memcpy(&size, p, sizeof(size));
+    p += sizeof(size);
+    // compared before multiplying, which could overflow.
+    if (size > static_cast<unsigned long long>(end - p)  // NOLINT
+                 / sizeof(T))
+      stan::math::invalid_argument(function, "cached schedule", "", "",
+                                   "is truncated!");
+    x.resize(size);
+    if (size > 0) std::memcpy(&x[0], p, size * sizeof(T));
+    return p + size * sizeof(T);
+  }
+
+  /**
+   * Returns the row of the columns which holds the ith event.
+   */
+  int Locate(int i) const {
+    if (first_.empty()) return i;
+    int e = std::upper_bound(first_.begin(), first_.end(), i)
+      - first_.begin() - 1;
+    return column_[e] + (i - first_[e]) % width_[e];
+  }
+
+  /**
+   * Train of additional doses of a dosing row which the schedule
+   * generates instead of storing them (see PlanTrains). Its doses are
+   * at the times origin + m * ii, for m = 1 to addl, and period m
+   * runs from dose m to dose m + 1. The runs of periods
+   * [first, first + length) are generated from their first period;
+   * the other periods are expanded.
+   */
+  struct Train {
+    double origin, ii, lag, duration;
+    int addl;  // last dose before the last kept event
+    std::vector<int> first, length;
+  };
+
+  /**
+   * Plans the trains of additional doses which are generated instead
+   * of expanded: the doses of a dosing row at t with addl doses
+   * every ii are at the times t + m * ii (see AddlDoseEvents), each
+   * possibly followed by its lagged dose (see AddLagTimes) and the
+   * end of its infusion (see MakeRates). When the parameters are
+   * constant over the events, the periods of the train with no other
+   * event hold the same events, shifted by ii: only the first period
+   * of each run of them is expanded, and the others are generated
+   * from it (see FoldTrains). The periods around the
+   * other events are expanded, so that these events are merged into
+   * the train in the order of the book-keeping.
+   *
+   * The times of the other events and the bounds of the periods are
+   * computed as in the book-keeping, so they are compared exactly.
+   * The number of operations grows with the number of rows of the
+   * schedule, not with the number of additional doses.
+   *
+   * A train is expanded as before if the parameter or lag time
+   * arrays have several rows, if it overlaps another train of
+   * additional doses, or if the lagged dose and the end of the
+   * infusion of a period may not fall before the next dose.
+   */
+  std::vector<Train> PlanTrains(const std::vector<double>& time,
+                                const std::vector<double>& amt,
+                                const std::vector<double>& rate,
+                                const std::vector<double>& ii,
+                                const std::vector<int>& evid,
+                                const std::vector<int>& cmt,
+                                const std::vector<int>& addl,
+                                const std::vector<std::vector<double> >&
+                                  tlag,
+                                std::vector<int>& generated) const {
+    using std::vector;
+    vector<Train> trains;
+    size_t n = time.size();
+    generated.assign(n, 0);
+    if (nTheta_ != 1 || nBiovar_ != 1 || nSystem_ != 1 || tlag.size() != 1
+        || n == 0 || ii.size() != n || addl.size() != n)
+      return trains;
+
+    // spans of the trains, and times of the events of the rows, with
+    // their lagged doses and ends of infusions.
+    vector<double> span_begin(n, 0), span_end(n, 0), times;
+    for (size_t r = 0; r < n; r++) {
+      times.push_back(time[r]);
+      if (evid[r] != 1 && evid[r] != 4) continue;
+      double lag = tlag[0][cmt[r] - 1], start = time[r];
+      if (lag != 0) {
+        start += lag;
+        times.push_back(start);
+      }
+      if (rate[r] > 0 && amt[r] > 0) times.push_back(start + amt[r] / rate[r]);
+      if (addl[r] > 0 && ii[r] > 0) {
+        span_begin[r] = time[r];
+        span_end[r] = time[r] + addl[r] * ii[r] + std::fabs(lag)
+          + (rate[r] > 0 && amt[r] > 0 ? amt[r] / rate[r] : 0);
+      }
+    }
+    double last = *std::max_element(time.begin(), time.end());
+
+    for (size_t r = 0; r < n; r++) {
+      if ((evid[r] != 1 && evid[r] != 4) || addl[r] <= 0 || ii[r] <= 0)
+        continue;
+      Train train;
+      train.origin = time[r];
+      train.ii = ii[r];
+      train.lag = tlag[0][cmt[r] - 1];
+      train.duration = (rate[r] > 0 && amt[r] > 0) ? amt[r] / rate[r] : 0;
+
+      // the events of a period end before the next dose, with a
+      // margin for the rounding of the times.
+      double slack = 8 * std::numeric_limits<double>::epsilon()
+        * (std::fabs(time[r]) + addl[r] * ii[r] + train.lag
+           + train.duration);
+      bool overlap = false;
+      for (size_t s = 0; s < n && !overlap; s++)
+        overlap = s != r && span_end[s] > span_begin[s]
+          && span_begin[s] <= span_end[r] && span_begin[r] <= span_end[s];
+      if (overlap || !(train.lag >= 0)
+          || !(train.lag + train.duration + slack < ii[r]))
+        continue;
+
+      // doses up to the last kept event, the others being dropped.
+      double t0 = train.origin, d = train.ii;
+      train.addl = static_cast<int>(std::min<double>(addl[r],
+                                    std::floor((last - t0) / d) + 1));
+      while (train.addl > 0 && t0 + train.addl * d > last) train.addl--;
+      while (train.addl < addl[r] && t0 + (train.addl + 1) * d <= last)
+        train.addl++;
+      if (train.addl < 2) continue;
+
+      // periods which hold another event.
+      vector<int> periods;
+      for (size_t k = 0; k < times.size(); k++) {
+        double t = times[k];
+        if (t < t0) continue;
+        int m0 = static_cast<int>(std::min<double>(train.addl,
+                                  std::floor((t - t0) / d)));
+        for (int m = std::max(1, m0 - 2);
+             m <= std::min(train.addl, m0 + 2); m++)
+          if (t0 + m * d <= t && t < t0 + (m + 1) * d)
+            periods.push_back(m);
+      }
+      std::sort(periods.begin(), periods.end());
+      periods.push_back(train.addl + 1);
+      int next = 1;
+      for (size_t k = 0; k < periods.size(); k++) {
+        if (periods[k] - next >= 2) {
+          train.first.push_back(next);
+          train.length.push_back(periods[k] - next);
+        }
+        next = std::max(next, periods[k] + 1);
+      }
+      if (train.first.empty()) continue;
+      trains.push_back(train);
+      generated[r] = 1;
+    }
+    return trains;
+  }
+
+  /**
+   * Stores the runs of periods of the trains planned by PlanTrains as
+   * entries which generate the times of their events from the rows
+   * of their first period. The other events get one entry each.
+   */
+  void FoldTrains(const std::vector<Train>& trains) {
+    using std::vector;
+    vector<std::pair<double, std::pair<int, int> > > runs;
+    for (size_t c = 0; c < trains.size(); c++)
+      for (size_t k = 0; k < trains[c].first.size(); k++)
+        runs.push_back(std::make_pair(trains[c].origin
+                                      + trains[c].first[k] * trains[c].ii,
+                                      std::make_pair(static_cast<int>(c),
+                                                     static_cast<int>(k))));
+    if (runs.empty()) return;
+    std::sort(runs.begin(), runs.end());
+
+    int nRow = time_.size(), r = 0, i = 0;
+    vector<int> first, column, width, mult;
+    vector<double> origin, step, lag(nRow, 0), duration(nRow, 0);
+    for (size_t k = 0; k <= runs.size(); k++) {
+      // rows of the first period of the run.
+      int begin = nRow, end = nRow;
+      const Train* train = 0;
+      int m = 0, length = 0;
+      if (k < runs.size()) {
+        train = &trains[runs[k].second.first];
+        m = train->first[runs[k].second.second];
+        length = train->length[runs[k].second.second];
+        double t0 = train->origin, d = train->ii;
+        begin = std::lower_bound(time_.begin(), time_.end(), t0 + m * d)
+          - time_.begin();
+        end = std::lower_bound(time_.begin(), time_.end(),
+                               t0 + (m + 1) * d) - time_.begin();
+      }
+
+      for (; r < begin; r++) {
+        first.push_back(i++);
+        column.push_back(r);
+        width.push_back(1);
+        mult.push_back(0);
+        origin.push_back(0);
+        step.push_back(0);
+      }
+      if (train == 0) break;
+
+      // the events of a period are its dose, after the row of the
+      // dose without its lag time, and before the end of the
+      // infusion (see AddLagTimes and MakeRates).
+      int q = begin;
+      if (train->lag != 0) q++;
+      for (; q < end; q++) {
+        lag[q] = train->lag;
+        if (q > begin && evid_[q] == 2) duration[q] = train->duration;
+      }
+      first.push_back(i);
+      column.push_back(begin);
+      width.push_back(end - begin);
+      mult.push_back(m);
+      origin.push_back(train->origin);
+      step.push_back(train->ii);
+      i += length * (end - begin);
+      r = end;
+    }
+
+    first.push_back(i);
+    first_.swap(first);
+    column_.swap(column);
+    width_.swap(width);
+    mult_.swap(mult);
+    origin_.swap(origin);
+    step_.swap(step);
+    lag_.swap(lag);
+    duration_.swap(duration);
+  }
+
+  /**
+   * Checks that the columns of a schedule read from a cache are
+   * consistent, so that a corrupt or stale cache is rejected instead
+   * of read out of bounds by the accessors.
+   */
+  void Validate() const {
+    static const char* function("EventSchedule::Read");
+    using stan::math::invalid_argument;
+    if (nCmt_ < 1 || nTheta_ < 1 || nBiovar_ < 1 || nSystem_ < 1
+        || nKeep_ < 0 || !(tolerance_ >= 0) || std::isinf(tolerance_))
+      invalid_argument(function, "cached schedule", "", "",
+                       "has an invalid header!");
+
+    size_t nRow = time_.size();
+    if (amt_.size() != nRow || rate_.size() != nRow || ii_.size() != nRow
+        || evid_.size() != nRow || cmt_.size() != nRow
+        || ss_.size() != nRow || keep_.size() != nRow
+        || theta_row_.size() != nRow || biovar_row_.size() != nRow
+        || system_row_.size() != nRow || rate_row_.size() != nRow)
+      invalid_argument(function, "cached schedule", "", "",
+                       "has columns of different lengths!");
+    if (rates_.size() % nCmt_ != 0)
+      invalid_argument(function, "cached schedule", "", "",
+                       "has a rate table of invalid length!");
+    int nRate = rates_.size() / nCmt_;
+    for (size_t r = 0; r < nRow; r++) {
+      if (theta_row_[r] < 0 || theta_row_[r] >= nTheta_
+          || biovar_row_[r] < 0 || biovar_row_[r] >= nBiovar_
+          || system_row_[r] < 0 || system_row_[r] >= nSystem_
+          || rate_row_[r] < 0 || rate_row_[r] >= nRate)
+        invalid_argument(function, "cached schedule", "", "",
+                         "has a row index out of range!");
+      if ((evid_[r] == 1 || evid_[r] == 4)
+          && (cmt_[r] < 1 || cmt_[r] > nCmt_))
+        invalid_argument(function, "cached schedule", "", "",
+                         "has a dose in an invalid compartment!");
+    }
+
+    // entries of the trains of doses (see FoldTrains).
+    size_t nEntry = first_.empty() ? 0 : first_.size() - 1;
+    if (column_.size() != nEntry || width_.size() != nEntry
+        || mult_.size() != nEntry || origin_.size() != nEntry
+        || step_.size() != nEntry
+        || lag_.size() != (first_.empty() ? 0 : nRow)
+        || duration_.size() != lag_.size()
+        || (!first_.empty() && first_[0] != 0))
+      invalid_argument(function, "cached schedule", "", "",
+                       "has inconsistent trains of doses!");
+    long int nKeep = 0;  // NOLINT(runtime/int)
+    for (size_t e = 0; e < nEntry; e++) {
+      int length = first_[e + 1] - first_[e];
+      if (length < 1 || width_[e] < 1 || length % width_[e] != 0
+          || column_[e] < 0
+          || column_[e] > static_cast<int>(nRow) - width_[e])
+        invalid_argument(function, "cached schedule", "", "",
+                         "has inconsistent trains of doses!");
+      for (int q = 0; q < width_[e]; q++)
+        nKeep += (keep_[column_[e] + q] != 0) * (length / width_[e]);
+    }
+    if (first_.empty())
+      for (size_t r = 0; r < nRow; r++) nKeep += (keep_[r] != 0);
+    if (nKeep != nKeep_)
+      invalid_argument(function, "cached schedule", "", "",
+                       "has an invalid number of kept events!");
+  }
+
+  void FindInfusions() {
+    infusions_ = false;
+    for (size_t i = 0; i < rates_.size(); i++)
+      if (rates_[i] != 0) infusions_ = true;
+  }
+
+  // Finds the first dose (see get_first_dose).
+  void FindFirstDose() {
+    Cursor event(*this, 0);
+    while (!event.done() && event.get_evid() != 1 && event.get_evid() != 4
+           && event.get_ss() == 0)
+      event.Next();
+    first_dose_ = event.get_index();
+  }
+
+  /**
+   * Finds the first event of each segment. Steady state events
+   * overwrite the amounts but not the AUCs, which are only set to
+   * zero by the resets, hence the segments of the AUCs.
+   */
+  void FindSegments() {
+    segments_.clear();
+    auc_segments_.clear();
+    for (Cursor event(*this, 0); !event.done(); event.Next()) {
+      int i = event.get_index(), evid = event.get_evid(),
+        ss = event.get_ss();
+      bool reset = (evid == 3) || (evid == 4);
+      if (i == 0 || reset) auc_segments_.push_back(i);
+      if (i == 0 || reset || ss == 3 || (evid == 1 && ss == 1))
+        segments_.push_back(i);
+    }
+  }
+
+public:
+  EventSchedule() : nCmt_(0), nTheta_(0), nBiovar_(0), nSystem_(0),
+                    nKeep_(0), checkpoint_(0), first_dose_(0), threads_(1),
+                    id_(0), tolerance_(0), infusions_(false) { }
+
+  /**
+   * Compiles an event schedule.
+   *
+   * @param[in] time times of events
+   * @param[in] amt amount at each event
+   * @param[in] rate rate at each event
+   * @param[in] ii inter-dose interval at each event
+   * @param[in] evid event identity
+   * @param[in] cmt compartment number at each event (starts at 1)
+   * @param[in] addl additional dosing at each event
+   * @param[in] ss steady state approximation at each event
+   * @param[in] tlag lag times at each event
+   * @param[in] nCmt number of compartments in the model
+   * @param[in] nTheta length of the parameter (2d) array
+   * @param[in] nBiovar length of the bio-variability (2d) array
+   * @param[in] nSystem length of the array of system matrices
+   *            (linOdeModel only)
+   * @param[in] time_tolerance the intervals between events shorter
+   *            than time_tolerance are empty in the sweeps, which
+   *            approximates the schedule (see Cursor::get_interval).
+   *            With 0 (the default), all the intervals are
+   *            integrated.
+   */
+  EventSchedule(const std::vector<double>& time,
+                const std::vector<double>& amt,
+                const std::vector<double>& rate,
+                const std::vector<double>& ii,
+                const std::vector<int>& evid,
+                const std::vector<int>& cmt,
+                const std::vector<int>& addl,
+                const std::vector<int>& ss,
+                const std::vector<std::vector<double> >& tlag,
+                int nCmt,
+                int nTheta = 1,
+                int nBiovar = 1,
+                int nSystem = 1,
+                double time_tolerance = 0)
+    : nCmt_(nCmt), nTheta_(nTheta), nBiovar_(nBiovar), nSystem_(nSystem),
+      checkpoint_(0), first_dose_(0), threads_(1), id_(0),
+      tolerance_(time_tolerance) {
+    using std::vector;
+    using Eigen::Matrix;
+    using Eigen::Dynamic;
+
+    static const char* function("EventSchedule");
+    if (nCmt < 1)
+      stan::math::invalid_argument(function, "number of compartments", nCmt,
+                                   "", " must be positive!");
+    if (nSystem != 1 && nSystem != static_cast<int>(time.size()))
+      stan::math::invalid_argument(function, "length of the system array",
+                                   nSystem, "", " must be 1 or the length of "
+                                   "the time array!");
+    if (!(time_tolerance >= 0) || std::isinf(time_tolerance))
+      stan::math::invalid_argument(function, "time tolerance",
+                                   time_tolerance, "", " must be finite and "
+                                   "non-negative!");
+
+    // The book-keeping runs on the rows of the parameter arrays
+    // instead of their values: each row holds its own index, which
+    // follows the row through the augmentation of the schedule.
+    vector<vector<double> > thetaRows(nTheta), biovarRows(nBiovar);
+    for (int i = 0; i < nTheta; i++) thetaRows[i].assign(1, i);
+    for (int i = 0; i < nBiovar; i++) biovarRows[i].assign(1, i);
+    vector<Matrix<double, Dynamic, Dynamic> > systemRows(nSystem);
+    for (int i = 0; i < nSystem; i++)
+      systemRows[i] = Matrix<double, Dynamic, Dynamic>::Constant(1, 1, i);
+
+    // The structure of the data is only checked here: the model
+    // functions taking a schedule only check the parameters.
+    pmetricsCheckData(time, amt, rate, ii, evid, cmt, addl, ss, function);
+    pmetricsCheckParameters(time.size(), thetaRows, biovarRows, tlag,
+                            function);
+
+    // the trains of additional doses which are generated are left out
+    // of the book-keeping, but for the periods which are expanded.
+    vector<int> generated;
+    vector<Train> trains = PlanTrains(time, amt, rate, ii, evid, cmt, addl,
+                                      tlag, generated);
+    vector<int> addl_expanded(addl);
+    for (size_t r = 0; r < generated.size(); r++)
+      if (generated[r]) addl_expanded[r] = 0;
+
+    // the histories are temporaries, drawn from the arena.
+    PredArenaScope arena;
+    EventHistory<double, double, double, double>
+      events(time, amt, rate, ii, evid, cmt, addl_expanded, ss);
+    ModelParameterHistory<double, double, double, double>
+      parameters(time, thetaRows, biovarRows, tlag, systemRows);
+    RateHistory<double, double> rates;
+
+    events.Sort();
+    parameters.Sort();
+    nKeep_ = events.get_size();
+
+    // same doses as AddlDoseEvents, inserted before its own.
+    for (size_t r = 0, c = 0; r < generated.size(); r++) {
+      if (!generated[r]) continue;
+      const Train& train = trains[c++];
+      for (int m = 1, k = 0; m <= train.addl; m++) {
+        if (k < static_cast<int>(train.first.size())
+            && m == train.first[k] + 1) {
+          m = train.first[k] + train.length[k] - 1;
+          k++;
+          continue;
+        }
+        events.InsertEvent(Event<double, double, double, double>(
+          time[r] + m * ii[r], amt[r], rate[r], 0, evid[r], cmt[r], 0, 0,
+          false, true));
+      }
+    }
+    events.AddlDoseEvents();
+    parameters.CompleteParameterHistory(events);
+
+    events.AddLagTimes(parameters, nCmt);
+    rates.MakeRates(events, nCmt);
+    parameters.CompleteParameterHistory(events);
+
+    // the events after the last kept event cannot change the
+    // predictions, and are dropped.
+    int nEvent = events.get_size();
+    while (nEvent > 0 && !events.get_keep(nEvent - 1)) nEvent--;
+    time_.resize(nEvent);
+    amt_.resize(nEvent);
+    rate_.resize(nEvent);
+    ii_.resize(nEvent);
+    evid_.resize(nEvent);
+    cmt_.resize(nEvent);
+    ss_.resize(nEvent);
+    keep_.resize(nEvent);
+    theta_row_.resize(nEvent);
+    biovar_row_.resize(nEvent);
+    system_row_.resize(nEvent);
+    rate_row_.resize(nEvent);
+
+    int iRate = 0;
+    for (int i = 0; i < nEvent; i++) {
+      time_[i] = events.get_time(i);
+      amt_[i] = events.get_amt(i);
+      rate_[i] = events.get_rate(i);
+      ii_[i] = events.get_ii(i);
+      evid_[i] = events.get_evid(i);
+      cmt_[i] = events.get_cmt(i);
+      ss_[i] = events.get_ss(i);
+      keep_[i] = events.get_keep(i);
+
+      // same look-up of the rate as in Pred.
+      if (rates.get_time(iRate) != events.get_time(i)) iRate++;
+      rate_row_[i] = iRate;
+
+      const ModelParameters<double, double, double, double>&
+        parameter = parameters.GetModelParameters(i);
+      theta_row_[i] = static_cast<int>(parameter.get_RealParameters()[0]);
+      biovar_row_[i] = static_cast<int>(parameter.get_biovar()[0]);
+      system_row_[i] = static_cast<int>(parameter.get_K()(0, 0));
+    }
+
+    rates_.resize(rates.Size() * nCmt);
+    for (int i = 0; i < rates.Size(); i++) {
+      for (int j = 0; j < nCmt; j++)
+        rates_[i * nCmt + j] = rates.get_rate(i)[j];
+    }
+    FoldTrains(trains);
+    FindInfusions();
+    FindSegments();
+    FindFirstDose();
+  }
+
+  /**
+   * Overload for lag times passed as a vector (constant over
+   * the events).
+   */
+  EventSchedule(const std::vector<double>& time,
+                const std::vector<double>& amt,
+                const std::vector<double>& rate,
+                const std::vector<double>& ii,
+                const std::vector<int>& evid,
+                const std::vector<int>& cmt,
+                const std::vector<int>& addl,
+                const std::vector<int>& ss,
+                const std::vector<double>& tlag,
+                int nCmt,
+                int nTheta = 1,
+                int nBiovar = 1,
+                int nSystem = 1,
+                double time_tolerance = 0)
+    : EventSchedule(time, amt, rate, ii, evid, cmt, addl, ss,
+                    std::vector<std::vector<double> >(1, tlag), nCmt,
+                    nTheta, nBiovar, nSystem, time_tolerance) { }
+
+  /**
+   * Checks that the lengths of the parameter arrays passed to a
+   * model function match the lengths the schedule was compiled for.
+   */
+  void CheckParameters(const char* function, int nCmt, int nTheta,
+                       int nBiovar, int nSystem = 1) const {
+    using stan::math::invalid_argument;
+    if (nCmt != nCmt_)
+      invalid_argument(function, "number of compartments", nCmt, "",
+                       " differs from the compiled event schedule!");
+    if (nTheta != nTheta_)
+      invalid_argument(function, "length of the parameter (2d) array",
+                       nTheta, "",
+                       " differs from the compiled event schedule!");
+    if (nBiovar != nBiovar_)
+      invalid_argument(function,
+                       "length of the biovariability parameter (2d) array",
+                       nBiovar, "",
+                       " differs from the compiled event schedule!");
+    if (nSystem != nSystem_)
+      invalid_argument(function, "length of the system array", nSystem, "",
+                       " differs from the compiled event schedule!");
+  }
+
+  // Access functions
+  double get_id() const { return id_; }
+  void set_id(double id) { id_ = id; }
+
+  /**
+   * Sets the number of events k between the checkpoints of Pred
+   * (see PredCheckpoint). With k > 0, the autodiff tape of Pred only
+   * holds k events at a time, and the amounts are stored every k
+   * events; the events are computed twice. With k < 0, k is the
+   * square root of the number of events. With k = 0 (the default),
+   * the whole tape is kept. With k != 0, the reverse pass reads the
+   * schedule again: it must outlive the gradient computation.
+   */
+  void set_checkpoint_interval(int k) { checkpoint_ = k; }
+  int get_checkpoint_interval() const { return checkpoint_; }
+
+  /**
+   * Sets the number of threads n over which Pred runs the segments
+   * of the schedule (see PredConcurrent), when the parameters are
+   * data and the model supports it. With n = 0, the number of
+   * cores is used. With n = 1 (the default), the schedule is swept
+   * on the calling thread.
+   */
+  void set_threads(int n) {
+    if (n < 0)
+      stan::math::invalid_argument("EventSchedule::set_threads",
+                                   "number of threads", n, "",
+                                   " must be positive or zero!");
+    threads_ = n;
+  }
+  int get_threads() const { return threads_; }
+  int get_size() const {
+    return first_.empty() ? time_.size() : first_.back();
+  }
+  int get_nKeep() const { return nKeep_; }
+  int get_nCmt() const { return nCmt_; }
+  int get_nTheta() const { return nTheta_; }
+  int get_nBiovar() const { return nBiovar_; }
+  int get_nSystem() const { return nSystem_; }
+  double get_time(int i) const {
+    if (first_.empty()) return time_[i];
+    int e = std::upper_bound(first_.begin(), first_.end(), i)
+      - first_.begin() - 1;
+    int k = i - first_[e], r = column_[e] + k % width_[e];
+    if (step_[e] == 0) return time_[r];
+    return ((origin_[e] + (mult_[e] + k / width_[e]) * step_[e]) + lag_[r])
+      + duration_[r];
+  }
+  double get_amt(int i) const { return amt_[Locate(i)]; }
+  double get_rate(int i) const { return rate_[Locate(i)]; }
+  double get_ii(int i) const { return ii_[Locate(i)]; }
+  int get_evid(int i) const { return evid_[Locate(i)]; }
+  int get_cmt(int i) const { return cmt_[Locate(i)]; }
+  int get_ss(int i) const { return ss_[Locate(i)]; }
+  bool get_keep(int i) const { return keep_[Locate(i)] != 0; }
+  int get_theta_row(int i) const { return theta_row_[Locate(i)]; }
+  int get_biovar_row(int i) const { return biovar_row_[Locate(i)]; }
+  int get_system_row(int i) const { return system_row_[Locate(i)]; }
+  int get_rate_row(int i) const { return rate_row_[Locate(i)]; }
+
+  /**
+   * Returns the number of rows stored for the events, which is
+   * smaller than the number of events when the schedule has trains
+   * of additional doses.
+   */
+  int CountRows() const { return time_.size(); }
+
+  /**
+   * Returns the index of the first dose (evid = 1 or 4, or steady
+   * state event), or the number of events if there is none. The
+   * amounts are zero up to this event for the models which keep
+   * zero amounts at zero (see preserves_zero_state).
+   */
+  int get_first_dose() const { return first_dose_; }
+
+  /**
+   * Returns the first event of each segment of the schedule, for
+   * the amounts (auc = false) or for the amounts and the AUCs.
+   */
+  const std::vector<int>& get_segments(bool auc = false) const {
+    return auc ? auc_segments_ : segments_;
+  }
+
+  /**
+   * Returns true if the rate in some compartment is not zero
+   * during some interval of the schedule.
+   */
+  bool HasInfusions() const { return infusions_; }
+
+  /**
+   * Returns the rate in compartment j (starts at 0) during the
+   * interval which ends at the i-th event.
+   */
+  double get_cmt_rate(int i, int j) const {
+    return rates_[get_rate_row(i) * nCmt_ + j];
+  }
+
+  /**
+   * Cursor over the events of the schedule, for the sweeps of Pred.
+   * The accessors of the schedule locate the entry of each event
+   * (see Locate); the cursor keeps the entry and the row of its
+   * event, and moves to the next event in constant time, which it
+   * pulls from the current train of doses. It also keeps the time
+   * of the previous event, which starts the interval of the event.
+   */
+  class Cursor {
+  private:
+    const EventSchedule* schedule_;
+    int i_, e_, k_, r_;  // event, entry, event in the entry, row
+    double time_, previous_time_;
+
+    // Sets the row and the time of the event, as get_time does.
+    void Update() {
+      const EventSchedule& s = *schedule_;
+      if (i_ >= s.get_size()) return;
+      if (s.first_.empty()) {
+        r_ = i_;
+        time_ = s.time_[r_];
+        return;
+      }
+      r_ = s.column_[e_] + k_ % s.width_[e_];
+      if (s.step_[e_] == 0)
+        time_ = s.time_[r_];
+      else
+        time_ = ((s.origin_[e_] + (s.mult_[e_] + k_ / s.width_[e_])
+                  * s.step_[e_]) + s.lag_[r_]) + s.duration_[r_];
+    }
+
+  public:
+    /**
+     * Starts the cursor at the ith event.
+     */
+    Cursor(const EventSchedule& schedule, int i)
+      : schedule_(&schedule), i_(i), e_(0), k_(0), r_(i), time_(0) {
+      if (!schedule.first_.empty() && i < schedule.get_size()) {
+        e_ = std::upper_bound(schedule.first_.begin(),
+                              schedule.first_.end(), i)
+          - schedule.first_.begin() - 1;
+        k_ = i - schedule.first_[e_];
+      }
+      Update();
+      previous_time_ = (i > 0 && i < schedule.get_size())
+        ? schedule.get_time(i - 1) : time_;
+    }
+
+    /**
+     * Moves to the next event.
+     */
+    void Next() {
+      const EventSchedule& s = *schedule_;
+      previous_time_ = time_;
+      i_++;
+      if (!s.first_.empty() && ++k_ == s.first_[e_ + 1] - s.first_[e_]) {
+        e_++;
+        k_ = 0;
+      }
+      Update();
+    }
+
+    /**
+     * Returns true if the cursor is past the last event.
+     */
+    bool done() const { return i_ >= schedule_->get_size(); }
+
+    int get_index() const { return i_; }
+    double get_time() const { return time_; }
+    double get_previous_time() const { return previous_time_; }
+
+    /**
+     * Returns the length of the interval which ends at the event,
+     * over which the amounts are integrated: 0 if it is shorter
+     * than the time tolerance of the schedule, e.g. between a dose
+     * and a sample recorded a few seconds apart. The dose is then
+     * absorbed and eliminated as if given at the time of the sample,
+     * which approximates the schedule; the predictions are still
+     * reported at the times of the events.
+     */
+    double get_interval() const {
+      double dt = time_ - previous_time_;
+      return dt < schedule_->tolerance_ ? 0 : dt;
+    }
+    double get_amt() const { return schedule_->amt_[r_]; }
+    double get_rate() const { return schedule_->rate_[r_]; }
+    double get_ii() const { return schedule_->ii_[r_]; }
+    int get_evid() const { return schedule_->evid_[r_]; }
+    int get_cmt() const { return schedule_->cmt_[r_]; }
+    int get_ss() const { return schedule_->ss_[r_]; }
+    bool get_keep() const { return schedule_->keep_[r_] != 0; }
+    int get_theta_row() const { return schedule_->theta_row_[r_]; }
+    int get_biovar_row() const { return schedule_->biovar_row_[r_]; }
+    int get_system_row() const { return schedule_->system_row_[r_]; }
+    int get_rate_row() const { return schedule_->rate_row_[r_]; }
+
+    /**
+     * Returns the rate in compartment j (starts at 0) during the
+     * interval which ends at the event.
+     */
+    double get_cmt_rate(int j) const {
+      return schedule_->rates_[get_rate_row() * schedule_->nCmt_ + j];
+    }
+  };
+
+  /**
+   * Writes the schedule in binary form, as a header, the ID of the
+   * subject and the time tolerance followed by one block per column
+   * (length, then values).
+   */
+  void Write(std::ostream& out) const {
+    int header[] = {nCmt_, nTheta_, nBiovar_, nSystem_, nKeep_};
+    out.write(reinterpret_cast<const char*>(header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(&id_), sizeof(id_));
+    out.write(reinterpret_cast<const char*>(&tolerance_),
+              sizeof(tolerance_));
+    WriteColumn(out, time_);
+    WriteColumn(out, amt_);
+    WriteColumn(out, rate_);
+    WriteColumn(out, ii_);
+    WriteColumn(out, evid_);
+    WriteColumn(out, cmt_);
+    WriteColumn(out, ss_);
+    WriteColumn(out, keep_);
+    WriteColumn(out, theta_row_);
+    WriteColumn(out, biovar_row_);
+    WriteColumn(out, system_row_);
+    WriteColumn(out, rate_row_);
+    WriteColumn(out, rates_);
+    WriteColumn(out, first_);
+    WriteColumn(out, column_);
+    WriteColumn(out, width_);
+    WriteColumn(out, mult_);
+    WriteColumn(out, origin_);
+    WriteColumn(out, step_);
+    WriteColumn(out, lag_);
+    WriteColumn(out, duration_);
+  }
+
+  /**
+   * Reads a schedule written by Write from the memory between
+   * begin and end.
+   *
+   * @return pointer past the end of the schedule.
+   */
+  const char* Read(const char* begin, const char* end) {
+    static const char* function("EventSchedule::Read");
+    int header[5];
+    if (end - begin < static_cast<long>(sizeof(header) + sizeof(id_)  // NOLINT
+                                        + sizeof(tolerance_)))
+      stan::math::invalid_argument(function, "cached schedule", "", "",
+                                   "is truncated!");
+    std::memcpy(header, begin, sizeof(header));
+    nCmt_ = header[0];
+    nTheta_ = header[1];
+    nBiovar_ = header[2];
+    nSystem_ = header[3];
+    nKeep_ = header[4];
+    std::memcpy(&id_, begin + sizeof(header), sizeof(id_));
+    std::memcpy(&tolerance_, begin + sizeof(header) + sizeof(id_),
+                sizeof(tolerance_));
+    const char* p = begin + sizeof(header) + sizeof(id_)
+      + sizeof(tolerance_);
+    p = ReadColumn(p, end, time_);
+    p = ReadColumn(p, end, amt_);
+    p = ReadColumn(p, end, rate_);
+    p = ReadColumn(p, end, ii_);
+    p = ReadColumn(p, end, evid_);
+    p = ReadColumn(p, end, cmt_);
+    p = ReadColumn(p, end, ss_);
+    p = ReadColumn(p, end, keep_);
+    p = ReadColumn(p, end, theta_row_);
+    p = ReadColumn(p, end, biovar_row_);
+    p = ReadColumn(p, end, system_row_);
+    p = ReadColumn(p, end, rate_row_);
+    p = ReadColumn(p, end, rates_);
+    p = ReadColumn(p, end, first_);
+    p = ReadColumn(p, end, column_);
+    p = ReadColumn(p, end, width_);
+    p = ReadColumn(p, end, mult_);
+    p = ReadColumn(p, end, origin_);
+    p = ReadColumn(p, end, step_);
+    p = ReadColumn(p, end, lag_);
+    p = ReadColumn(p, end, duration_);
+    Validate();
+    FindInfusions();
+    FindSegments();
+    FindFirstDose();
+    return p;
+  }
+};
+
+}  // torsten namespace
+
+#endif
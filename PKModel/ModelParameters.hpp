@@ -3,8 +3,10 @@
 
 #include <Eigen/Dense>
 #include <stan/math/torsten/PKModel/Event.hpp>
+#include <stan/math/torsten/PKModel/arena.hpp>
 #include <stan/math/torsten/PKModel/ExtractVector.hpp>
 #include <stan/math/torsten/PKModel/SearchReal.hpp>
+#include <stan/math/torsten/PKModel/same_value.hpp>
 #include <algorithm>
 #include <vector>
 
@@ -100,10 +102,22 @@ public:
   /**
    * Edit time stored in parameter object.
    */
-  void time(double time) {
+  template <typename T>
+  void time(const T& time) {
     time_ = time;
   }
 
+  /**
+   * Returns true if the parameters (but not the time) of the two
+   * objects are interchangeable (see same_value).
+   */
+  bool SameParameters(const ModelParameters& other) const {
+    return same_value(theta_, other.theta_)
+      && same_value(biovar_, other.biovar_)
+      && same_value(tlag_, other.tlag_)
+      && same_value(K_, other.K_);
+  }
+
   int CountParameters() const {
     return theta_.size();
   }
@@ -122,16 +136,17 @@ public:
 
   // access functions
   T_time get_time() const { return time_; }
-  std::vector<T_parameters> get_RealParameters() const {
+  const std::vector<T_parameters>& get_RealParameters() const {
     return theta_;  // FIX ME - name should be get_theta.
   }
-  std::vector<T_biovar> get_biovar() const {
+  const std::vector<T_biovar>& get_biovar() const {
     return biovar_;
   }
-  std::vector<T_tlag> get_tlag() const {
+  const std::vector<T_tlag>& get_tlag() const {
     return tlag_;
   }
-  Eigen::Matrix<T_parameters, Eigen::Dynamic, Eigen::Dynamic> get_K() const {
+  const Eigen::Matrix<T_parameters, Eigen::Dynamic, Eigen::Dynamic>&
+  get_K() const {
     return K_;
   }
 
@@ -139,9 +154,15 @@ public:
 };
 
 /**
- * The ModelParameterHistory class defines objects that contain a vector
- * of ModelParameters, along with a series of functions that operate on
- * them.
+ * The ModelParameterHistory class defines objects that contain the
+ * parameters of the model at each event, along with a series of
+ * functions that operate on them.
+ *
+ * Consecutive events with the same parameters (for instance when
+ * a covariate only changes every few weeks, or when the parameters
+ * are constant) share one parameter set: the object stores the
+ * distinct sets, and for each event its time and the index of its
+ * set (see GetIndex).
  */
 template<typename T_time,
          typename T_parameters,
@@ -149,8 +170,30 @@ template<typename T_time,
          typename T_tlag>
 class ModelParameterHistory{
 private:
-  std::vector< ModelParameters<T_time, T_parameters,
-                               T_biovar, T_tlag> > MPV_;
+  typedef ModelParameters<T_time, T_parameters, T_biovar, T_tlag>
+    parameters_type;
+
+  struct Entry {
+    T_time time;
+    int index;  // index of the parameter set in MPV_
+
+    Entry() : time(0), index(0) { }
+    Entry(const T_time& t, int i) : time(t), index(i) { }
+  };
+
+  std::vector<parameters_type, arena_allocator<parameters_type> > MPV_;
+  std::vector<Entry, arena_allocator<Entry> > entries_;
+
+  /**
+   * Adds an entry for the parameters M, which shares the set of the
+   * last entry if their parameters are the same.
+   */
+  void PushParameters(const parameters_type& M) {
+    if (entries_.empty()
+        || !MPV_[entries_.back().index].SameParameters(M))
+      MPV_.push_back(M);
+    entries_.push_back(Entry(M.time_, MPV_.size() - 1));
+  }
 
 public:
   template<typename T0, typename T1, typename T2, typename T3>
@@ -163,94 +206,129 @@ public:
     using std::max;
     int nParameters = max(theta.size(),
                           max(K.size(), max(biovar.size(), tlag.size())));
-    MPV_.resize(nParameters);
-    int j, k, l, m;
-    // FIX ME - is this the most efficient way of storing data?
+    entries_.reserve(nParameters);
+    int j, k, l, m, j0 = -1, k0 = -1, l0 = -1, m0 = -1;
     for (int i = 0; i < nParameters; i++) {
       (theta.size() == 1) ? j = 0 : j = i;
       (biovar.size() == 1) ? k = 0 : k = i;
       (tlag.size() == 1) ? l = 0 : l = i;
       (K.size() == 1) ? m = 0 : m = i;
-       MPV_[i] = ModelParameters<T_time, T_parameters, T_biovar, T_tlag>
-         (time[i], theta[j], biovar[k], tlag[l], K[m]);
+      // rows which are constant over the events are not compared.
+      if (i > 0 && (j == j0 || same_value(theta[j], theta[j0]))
+          && (k == k0 || same_value(biovar[k], biovar[k0]))
+          && (l == l0 || same_value(tlag[l], tlag[l0]))
+          && (m == m0 || same_value(K[m], K[m0]))) {
+        entries_.push_back(Entry(time[i], entries_.back().index));
+      } else {
+        MPV_.push_back(ModelParameters<T_time, T_parameters, T_biovar,
+                       T_tlag>(time[i], theta[j], biovar[k], tlag[l], K[m]));
+        entries_.push_back(Entry(time[i], MPV_.size() - 1));
+      }
+      j0 = j;
+      k0 = k;
+      l0 = l;
+      m0 = m;
     }
   }
 
-  ModelParameters<T_time, T_parameters, T_biovar, T_tlag>
-    GetModelParameters(int i) {
-      return MPV_[i];
+  /**
+   * Returns the parameters at the ith event. The object is shared
+   * by the events with the same parameters, so that its time is
+   * that of the first of them: the time of the event is given by
+   * get_time().
+   */
+  const ModelParameters<T_time, T_parameters, T_biovar, T_tlag>&
+    GetModelParameters(int i) const {
+      return MPV_[entries_[i].index];
+  }
+
+  /**
+   * Returns the index of the parameter set of the ith event. Two
+   * events with the same index have the same parameters.
+   */
+  int GetIndex(int i) const {
+    return entries_[i].index;
+  }
+
+  /**
+   * Returns the number of distinct parameter sets.
+   */
+  int CountParameterSets() const {
+    return MPV_.size();
+  }
+
+  const T_time& get_time(int i) const {
+    return entries_[i].time;
   }
 
   /**
-   * MPV.size gives us the number of events.
-   * MPV[i].RealParameters.size gives us the number of
-   * ODE parameters for the ith event.
+   * entries_.size gives us the number of events.
+   * theta_.size of a parameter set gives us the number of
+   * ODE parameters.
    * 
    * FIX ME - rename this GetValueTheta
    */
-  T_parameters GetValue(int iEvent, int iParameter) {
-    assert((iEvent >= 0) && ((size_t) iEvent < MPV_.size()));
-    assert((iParameter >= 0) && ((size_t) iParameter
-      < MPV_[iEvent].theta_.size()));
-    return MPV_[iEvent].theta_[iParameter];
+  T_parameters GetValue(int iEvent, int iParameter) const {
+    assert((iEvent >= 0) && ((size_t) iEvent < entries_.size()));
+    const parameters_type& M = MPV_[entries_[iEvent].index];
+    assert((iParameter >= 0) && ((size_t) iParameter < M.theta_.size()));
+    return M.theta_[iParameter];
   }
 
-  T_biovar GetValueBio(int iEvent, int iParameter) {
-    assert(iEvent >= 0 && (size_t) iEvent < MPV_.size());
-    assert(iParameter >= 0 && (size_t) iParameter
-             < MPV_[iEvent].biovar_.size());
-    return MPV_[iEvent].biovar_[iParameter];
+  T_biovar GetValueBio(int iEvent, int iParameter) const {
+    assert(iEvent >= 0 && (size_t) iEvent < entries_.size());
+    const parameters_type& M = MPV_[entries_[iEvent].index];
+    assert(iParameter >= 0 && (size_t) iParameter < M.biovar_.size());
+    return M.biovar_[iParameter];
   }
 
-  T_tlag GetValueTlag(int iEvent, int iParameter) {
-    assert(iEvent >= 0 && (size_t) iEvent < MPV_.size());
-    assert(iParameter >= 0 && (size_t) iParameter
-             < MPV_[iEvent].tlag_.size());
-    return MPV_[iEvent].tlag_[iParameter];
+  T_tlag GetValueTlag(int iEvent, int iParameter) const {
+    assert(iEvent >= 0 && (size_t) iEvent < entries_.size());
+    const parameters_type& M = MPV_[entries_[iEvent].index];
+    assert(iParameter >= 0 && (size_t) iParameter < M.tlag_.size());
+    return M.tlag_[iParameter];
   }
 
   void InsertModelParameters(ModelParameters<T_time, T_parameters,
     T_biovar, T_tlag> M) {
-    MPV_.push_back(M);
+    PushParameters(M);
   }
 
-  int get_size() {
-    return MPV_.size();
+  int get_size() const {
+    return entries_.size();
   }
 
   struct by_time {
-    bool operator()(ModelParameters<T_time, T_parameters, T_biovar,
-                                    T_tlag> const &a,
-                    ModelParameters<T_time, T_parameters, T_biovar,
-                                    T_tlag> const &b) {
-      return a.time_ < b.time_;
+    bool operator()(Entry const &a, Entry const &b) {
+      return a.time < b.time;
     }
   };
 
   void Sort() {
-    std::sort(MPV_.begin(), MPV_.end(), by_time());
+    std::sort(entries_.begin(), entries_.end(), by_time());
   }
 
-  bool Check() {
+  bool Check() const {
   // check that elements are in chronological order.
-    int i = MPV_.size() - 1;
+    int i = entries_.size() - 1;
     bool ordered = true;
 
     while (i > 0 && ordered) {
-      ordered = (MPV_[i].time_ >= MPV_[i-1].time_);
+      ordered = (entries_[i].time >= entries_[i-1].time);
       i--;
     }
     return ordered;
   }
 
-  void Print(int j) {
-    std::cout << MPV_[j].time_ << " ";
-      for (size_t i = 0; i < MPV_[j].theta_.size(); i++)
-        std::cout << MPV_[j].theta_[i] << " ";
-      for (size_t i = 0; i < MPV_[j].biovar_.size(); i++)
-        std::cout << MPV_[j].biovar_[i] << " ";
-      for (size_t i = 0; i < MPV_[j].tlag_.size(); i++)
-        std::cout << MPV_[j].tlag_[i] << " ";
+  void Print(int j) const {
+    const parameters_type& M = MPV_[entries_[j].index];
+    std::cout << entries_[j].time << " ";
+      for (size_t i = 0; i < M.theta_.size(); i++)
+        std::cout << M.theta_[i] << " ";
+      for (size_t i = 0; i < M.biovar_.size(); i++)
+        std::cout << M.biovar_[i] << " ";
+      for (size_t i = 0; i < M.tlag_.size(); i++)
+        std::cout << M.tlag_[i] << " ";
       std::cout << std::endl;
   }
 
@@ -259,9 +337,9 @@ public:
    *
    * Completes parameters so that it contains model parameters for each event 
    * in events. If parameters contains only one set of parameters (case where
-   * the parameters are constant), this set is replicated for each event in
-   * events. Otherwise a new parameter vector is added for each new event 
-   * (isnew = true). This parameter vector is identical to the parameter vector
+   * the parameters are constant), this set is shared by each event in
+   * events. Otherwise a new entry is added for each new event 
+   * (isnew = true). This entry shares the parameter vector
    * at the subsequent event. If the new event occurs at a time posterior to
    * the time of the last event, than the new vector parameter equals the
    * parameter vector of the last event. This amounts to doing an LOCF
@@ -277,41 +355,36 @@ public:
   void CompleteParameterHistory(torsten::EventHistory<T0, T1, T2, T3>& events) {
     int nEvent = events.get_size();
     assert(nEvent > 0);
-    int len_Parameters = MPV_.size();  // numbers of events for which parameters
-                                       // are determined
+    int len_Parameters = entries_.size();  // numbers of events for which
+                                           // parameters are determined
     assert(len_Parameters > 0);
 
     if (!Check()) Sort();
     if (!events.Check()) events.Sort();
-    MPV_.resize(nEvent);
+    entries_.resize(nEvent);
 
     int iEvent = 0;
     for (int i = 0; i < len_Parameters - 1; i++) {
       while (events.get_isnew(iEvent)) iEvent++;  // skip new events
-      assert(MPV_[i].time_ == events.get_time(iEvent));  // compare time of
-                                                         // "old' events to
-                                                         // time of
-                                                         // parameters.
+      assert(entries_[i].time == events.get_time(iEvent));  // compare time
+                                                            // of "old'
+                                                            // events to
+                                                            // time of
+                                                            // parameters.
       iEvent++;
     }
 
     if (len_Parameters == 1)  {
       for (int i = 0; i < nEvent; i++) {
-        // FIX ME - inefficient data storage
-        MPV_[i].theta_ = MPV_[0].theta_;
-        MPV_[i].biovar_ = MPV_[0].biovar_;
-        MPV_[i].tlag_ = MPV_[0].tlag_;
-        MPV_[i].K_ = MPV_[0].K_;
-        MPV_[i].time_ = events.get_time(i);
+        entries_[i] = Entry(events.get_time(i), entries_[0].index);
         events.Events[i].isnew = false;
       }
     } else {  // parameters are event dependent.
       std::vector<T_time> times(nEvent, 0);
-      for (int i = 0; i < nEvent; i++) times[i] = MPV_[i].time_;
+      for (int i = 0; i < nEvent; i++) times[i] = entries_[i].time;
       iEvent = 0;
 
       int k, j = 0;
-      ModelParameters<T_time, T_parameters, T_biovar, T_tlag> newParameter;
 
       for (int i = 0; i < nEvent; i++) {
         while (events.get_isnew(iEvent)) {
@@ -333,13 +406,12 @@ public:
           k = SearchReal(times, len_Parameters - 1, events.get_time(iEvent));
 
           if ((k == len_Parameters) ||
-            (events.get_time(iEvent) == MPV_[k - 1].time_))
-            newParameter = GetModelParameters(k - 1);
-          else
-            newParameter = GetModelParameters(k);
+            (events.get_time(iEvent) == entries_[k - 1].time))
+            k--;
 
-          newParameter.time_ = events.get_time(iEvent);
-          MPV_[len_Parameters + j] = newParameter;
+          // the new event shares the parameter set.
+          entries_[len_Parameters + j] = Entry(events.get_time(iEvent),
+                                               entries_[k].index);
           events.Events[iEvent].isnew = false;
           if (iEvent < nEvent - 1) iEvent++;
           j++;
@@ -4,6 +4,10 @@
 #include <stan/math/prim/arr/meta/get.hpp>
 #include <stan/math/prim/mat/meta/get.hpp>
 
+#include <stan/math/torsten/PKModel/profile.hpp>
+#include <stan/math/torsten/PKModel/trace.hpp>
+#include <stan/math/torsten/PKModel/tape_footprint.hpp>
+#include <stan/math/torsten/PKModel/arena.hpp>
 #include <stan/math/torsten/PKModel/pmetricsCheck.hpp>
 #include <stan/math/torsten/PKModel/functions.hpp>
 #include <stan/math/torsten/PKModel/SearchReal.hpp>
@@ -12,10 +16,14 @@
 #include <stan/math/torsten/PKModel/Event.hpp>
 #include <stan/math/torsten/PKModel/Rate.hpp>
 #include <stan/math/torsten/PKModel/ModelParameters.hpp>
+#include <stan/math/torsten/PKModel/EventSchedule.hpp>
+#include <stan/math/torsten/PKModel/PredSink.hpp>
 #include <stan/math/torsten/PKModel/integrator.hpp>
 #include <stan/math/torsten/PKModel/Pred/PolyExp.hpp>
 // #include <stan/math/torsten/PKModel/Pred1.hpp>
 // #include <stan/math/torsten/PKModel/PredSS.hpp>
+#include <stan/math/torsten/PKModel/PredSchedule.hpp>
+#include <stan/math/torsten/PKModel/PredCheckpoint.hpp>
 #include <stan/math/torsten/PKModel/Pred.hpp>
 
 extern int marker_count;  // For testing purposes
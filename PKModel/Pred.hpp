@@ -1,6 +1,17 @@
 #ifndef STAN_MATH_TORSTEN_PKMODEL_PRED_HPP
 #define STAN_MATH_TORSTEN_PKMODEL_PRED_HPP
 
+#include <stan/math/torsten/PKModel/profile.hpp>
+#include <stan/math/torsten/PKModel/trace.hpp>
+#include <stan/math/torsten/PKModel/tape_footprint.hpp>
+#include <stan/math/torsten/PKModel/arena.hpp>
+#include <stan/math/torsten/PKModel/work_budget.hpp>
+#include <stan/math/torsten/PKModel/Pred/unpromote.hpp>
+#include <stan/math/torsten/PKModel/EventSchedule.hpp>
+#include <stan/math/torsten/PKModel/PredSink.hpp>
+#include <stan/math/torsten/PKModel/PredSchedule.hpp>
+#include <stan/math/torsten/PKModel/PredCheckpoint.hpp>
+#include <stan/math/torsten/PKModel/PredConcurrent.hpp>
 #include <Eigen/Dense>
 #include <vector>
 
@@ -51,6 +62,10 @@ namespace torsten{
  * @param[in] SystemODE matrix describing linear ODE system that
  * defines compartment model. Used for matrix exponential solutions.
  * Included because it may get updated in modelParameters.
+ * @param[in] auc_cmt compartments (starting at 1) whose AUC is
+ * returned after the amounts, in as many extra columns. The AUC is
+ * the integral of the amount since the first event or the last
+ * reset event (see Pred1AUC for the models which support it).
  * @return a matrix with predicted amount in each compartment
  * at each event.
  */
@@ -81,19 +96,30 @@ Pred(const std::vector<T_time>& time,
      const std::vector<Eigen::Matrix<T_parameters,
        Eigen::Dynamic, Eigen::Dynamic> >& system,
      const F_one& Pred1,
-     const F_SS& PredSS) {
+     const F_SS& PredSS,
+     const std::vector<int>& auc_cmt = std::vector<int>()) {
   using Eigen::Matrix;
   using Eigen::Dynamic;
   using boost::math::tools::promote_args;
   using std::vector;
-  using::stan::math::multiply;
 
   typedef typename promote_args<T_time, T_amt, T_rate, T_ii,
     typename promote_args<T_parameters, T_biovar, T_tlag>::type >::type scalar;
   typedef typename promote_args<T_time, T_tlag>::type T_tau;
   typedef typename promote_args<T_rate, T_biovar>::type T_rate2;
 
+  TORSTEN_PROFILE_SCOPE("Pred");
+  TORSTEN_TAPE_SCOPE("Pred");
+  WorkBudgetScope budget;
+  CheckAUCCompartments(auc_cmt, nCmt);
+  int nAuc = auc_cmt.size();
+
   // BOOK-KEEPING: UPDATE DATA SETS
+  // The histories are allocated from the arena of the thread, which
+  // is released when Pred returns.
+  PredArenaScope arena;
+  TORSTEN_PROFILE_START(events_timer, "Pred::events");
+  TORSTEN_TAPE_START(events_tape, "Pred::events");
   EventHistory<T_tau, T_amt, T_rate, T_ii>
     events(time, amt, rate, ii, evid, cmt, addl, ss);
 
@@ -106,68 +132,128 @@ Pred(const std::vector<T_time>& time,
   int nKeep = events.get_size();
 
   events.AddlDoseEvents();
-  parameters.CompleteParameterHistory(events);
+  TORSTEN_PROFILE_STOP(events_timer);
+  TORSTEN_TAPE_STOP(events_tape);
+
+  {
+    TORSTEN_PROFILE_SCOPE("Pred::parameters");
+    TORSTEN_TAPE_SCOPE("Pred::parameters");
+    parameters.CompleteParameterHistory(events);
+  }
+
+  {
+    TORSTEN_PROFILE_SCOPE("Pred::lag_times");
+    TORSTEN_TAPE_SCOPE("Pred::lag_times");
+    events.AddLagTimes(parameters, nCmt);
+  }
+
+  {
+    TORSTEN_PROFILE_SCOPE("Pred::rates");
+    TORSTEN_TAPE_SCOPE("Pred::rates");
+    rates.MakeRates(events, nCmt);
+  }
+
+  {
+    TORSTEN_PROFILE_SCOPE("Pred::parameters");
+    TORSTEN_TAPE_SCOPE("Pred::parameters");
+    parameters.CompleteParameterHistory(events);
+  }
 
-  events.AddLagTimes(parameters, nCmt);
-  rates.MakeRates(events, nCmt);
-  parameters.CompleteParameterHistory(events);
+  // When there are no infusions and the rates are data, zero rates
+  // (as data) are passed to Pred1 instead of the rates scaled by the
+  // bio-availability, which saves their copies and autodiff nodes.
+  bool infusions = !stan::is_constant_struct<T_rate>::value
+    || rates.HasInfusions();
+  const vector<double> no_rates(nCmt, 0);
 
   Matrix<scalar, 1, Dynamic> zeros = Matrix<scalar, 1, Dynamic>::Zero(nCmt);
   Matrix<scalar, 1, Dynamic> init = zeros;
+  Matrix<scalar, 1, Dynamic> auc = Matrix<scalar, 1, Dynamic>::Zero(nAuc),
+    auc1;
 
   // COMPUTE PREDICTIONS
   Matrix<scalar, Dynamic, Dynamic>
-    pred = Matrix<scalar, Dynamic, Dynamic>::Zero(nKeep, nCmt);
-
-  scalar Scalar = 1;  // trick to promote variables to scalar
+    pred = Matrix<scalar, Dynamic, Dynamic>::Zero(nKeep, nCmt + nAuc);
 
   T_tau dt, tprev = events.get_time(0);
   Matrix<scalar, Dynamic, 1> pred1;
+  vector<T_rate2> rate2(nCmt);
   Event<T_tau, T_amt, T_rate, T_ii> event;
   ModelParameters<T_tau, T_parameters, T_biovar, T_tlag> parameter;
-  int iRate = 0, ikeep = 0;
+  int iRate = 0, ikeep = 0, iParameter = -1;
 
-  for (int i = 0; i < events.get_size(); i++) {
+  // the events after the last kept event cannot change the
+  // predictions.
+  for (int i = 0; i < events.get_size() && ikeep < nKeep; i++) {
     event = events.GetEvent(i);
+    TORSTEN_TRACE_SPAN(event_span, "event");
+    TORSTEN_TRACE_ARG(event_span, "index", i);
+    TORSTEN_TRACE_ARG(event_span, "time", unpromote(event.get_time()));
+    TORSTEN_TRACE_ARG(event_span, "evid", event.get_evid());
 
     // Use index iRate instead of i to find rate at matching time, given there
     // is one rate per time, not per event.
     if (rates.get_time(iRate) != events.get_time(i)) iRate++;
-    Rate<T_tau, T_rate2> rate2;
-    rate2.copy(rates.GetRate(iRate));
-
-    for (int j = 0; j < nCmt; j++)
-      rate2.rate[j] *= parameters.GetValueBio(i, j);
+    if (infusions) {
+      for (int j = 0; j < nCmt; j++)
+        rate2[j] = BiovarRate(rates.get_rate(iRate)[j],
+                              parameters.GetValueBio(i, j));
+    }
 
-    parameter = parameters.GetModelParameters(i);
+    // the parameters are only copied when they change (see
+    // ModelParameterHistory).
+    if (parameters.GetIndex(i) != iParameter) {
+      iParameter = parameters.GetIndex(i);
+      parameter = parameters.GetModelParameters(i);
+    }
+    parameter.time(parameters.get_time(i));
 
     if ((event.get_evid() == 3) || (event.get_evid() == 4)) {  // reset events
       dt = 0;
       init = zeros;
+      auc.setZero();
     } else {
+      TORSTEN_PROFILE_SCOPE("Pred::Pred1");
+      TORSTEN_TAPE_SCOPE("Pred::Pred1");
       dt = event.get_time() - tprev;
-      pred1 = Pred1(dt, parameter, init, rate2.get_rate());
+      TORSTEN_TRACE_SPAN(pred1_span, "Pred1");
+      TORSTEN_TRACE_ARG(pred1_span, "functor", FunctorName<F_one>());
+      TORSTEN_TRACE_ARG(pred1_span, "dt", unpromote(dt));
+      if (nAuc == 0) {
+        if (infusions)
+          pred1 = Pred1(dt, parameter, init, rate2);
+        else
+          pred1 = Pred1(dt, parameter, init, no_rates);
+      } else {
+        if (infusions)
+          Pred1AUC(Pred1, dt, parameter, init, rate2, auc_cmt,
+                   pred1, auc1);
+        else
+          Pred1AUC(Pred1, dt, parameter, init, no_rates, auc_cmt, pred1,
+                   auc1);
+        auc += auc1;
+      }
       init = pred1;
     }
 
     if (((event.get_evid() == 1 || event.get_evid() == 4)
       && (event.get_ss() == 1 || event.get_ss() == 2)) ||
       event.get_ss() == 3) {  // steady state event
-      pred1 = multiply(PredSS(parameter,
-                              parameters.GetValueBio(i, event.get_cmt() - 1)
-                                * event.get_amt(),
-                              event.get_rate(), event.get_ii(),
-                              event.get_cmt()),
-                       Scalar);
-
+      TORSTEN_PROFILE_SCOPE("Pred::PredSS");
+      TORSTEN_TAPE_SCOPE("Pred::PredSS");
+      TORSTEN_TRACE_SPAN(predSS_span, "PredSS");
+      TORSTEN_TRACE_ARG(predSS_span, "functor", FunctorName<F_SS>());
+      TORSTEN_TRACE_ARG(predSS_span, "ss", event.get_ss());
+      TORSTEN_TRACE_ARG(predSS_span, "ii", unpromote(event.get_ii()));
       // the object PredSS returns doesn't always have a scalar type. For
-      // instance, PredSS does not depend on tlag, but pred does. So if
-      // tlag were a var, the code must promote PredSS to match the type
-      // of pred1. This is done by multiplying predSS by a Scalar.
-
-      if (event.get_ss() == 2) init += pred1;  // steady state without reset
-      else
-        init = pred1;  // steady state with reset (ss = 1)
+      // instance, PredSS does not depend on tlag, but pred does. Its
+      // amounts are promoted as they are stored in init.
+      SteadyState(init, PredSS(parameter,
+                               parameters.GetValueBio(i, event.get_cmt() - 1)
+                                 * event.get_amt(),
+                               event.get_rate(), event.get_ii(),
+                               event.get_cmt()),
+                  event.get_ss());
     }
 
     if (((event.get_evid() == 1) || (event.get_evid() == 4)) &&
@@ -177,7 +263,10 @@ Pred(const std::vector<T_time>& time,
     }
 
     if (event.get_keep()) {
-      pred.row(ikeep) = init;
+      TORSTEN_PROFILE_SCOPE("Pred::output");
+      TORSTEN_TAPE_SCOPE("Pred::output");
+      pred.block(ikeep, 0, 1, nCmt) = init;
+      if (nAuc > 0) pred.block(ikeep, nCmt, 1, nAuc) = auc;
       ikeep++;
     }
   tprev = event.get_time();
@@ -186,6 +275,63 @@ Pred(const std::vector<T_time>& time,
   return pred;
 }
 
+/**
+ * Overload of Pred for an event schedule compiled beforehand (see
+ * EventSchedule). The book-keeping steps are skipped: the events,
+ * rates and rows of the parameter arrays are read from the
+ * schedule, and only the predictions are computed.
+ *
+ * If the schedule has a checkpoint interval and no sink is given,
+ * the sweep is checkpointed (see PredCheckpoint). If it has several
+ * threads and no sink is given, its segments are computed
+ * concurrently (see PredConcurrent).
+ *
+ * @tparam T_parameters type of scalar for the ODE parameters
+ * @tparam T_biovar type of scalar for bio-variability parameters
+ * @param[in] schedule compiled event schedule
+ * @param[in] pMatrix parameters at each event
+ * @param[in] biovar bio-variability at each event
+ * @param[in] nCmt number of compartments in the model
+ * @param[in] system matrices describing linear ODE systems
+ * @param[in] sink if not null, receives the predicted amounts at
+ * each kept event (with the ID of the schedule), which are then
+ * not stored in the returned matrix.
+ * @param[in] auc_cmt compartments (starting at 1) whose AUC is
+ * returned after the amounts.
+ * @return a matrix with predicted amount in each compartment
+ * at each event, or an empty matrix if sink is not null.
+ */
+template<typename T_parameters,
+         typename T_biovar,
+         typename F_one,
+         typename F_SS>
+Eigen::Matrix<typename boost::math::tools::promote_args<T_parameters,
+  T_biovar>::type, Eigen::Dynamic, Eigen::Dynamic>
+Pred(const EventSchedule& schedule,
+     const std::vector<std::vector<T_parameters> >& pMatrix,
+     const std::vector<std::vector<T_biovar> >& biovar,
+     const int& nCmt,
+     const std::vector<Eigen::Matrix<T_parameters,
+       Eigen::Dynamic, Eigen::Dynamic> >& system,
+     const F_one& Pred1,
+     const F_SS& PredSS,
+     PredSink* sink = 0,
+     const std::vector<int>& auc_cmt = std::vector<int>()) {
+  TORSTEN_PROFILE_SCOPE("Pred");
+  TORSTEN_TAPE_SCOPE("Pred");
+  WorkBudgetScope budget;
+  CheckAUCCompartments(auc_cmt, nCmt);
+
+  if (!sink && schedule.get_checkpoint_interval() != 0)
+    return PredCheckpoint(schedule, pMatrix, biovar, nCmt, system, Pred1,
+                          PredSS, auc_cmt);
+  if (!sink && schedule.get_threads() != 1)
+    return PredConcurrent(schedule, pMatrix, biovar, nCmt, system, Pred1,
+                          PredSS, auc_cmt);
+  return PredSweep(schedule, pMatrix, biovar, nCmt, system, Pred1, PredSS,
+                   sink, auc_cmt);
+}
+
 }
 
 #endif
@@ -2,6 +2,7 @@
 #define STAN_MATH_TORSTEN_PKMODEL_POLYEXP_HPP
 
 #include <math.h>
+#include <cmath>
 #include <iostream>
 #include <limits>
 #include <vector>
@@ -162,6 +163,80 @@ PolyExp(const T_x& x,
   return bolusResult + rate * result;
 }
 
+/**
+ * Returns phi_m(x) = sum(n >= 0) (-x)^n / (n + m)!, for m = 1 or 2,
+ * that is phi_1(x) = (1 - exp(-x)) / x and
+ * phi_2(x) = (x - 1 + exp(-x)) / x^2. Their closed forms cancel for
+ * small x (and are 0/0 at 0), where the series is summed instead.
+ *
+ * @tparam T type of scalar for x
+ * @param[in] x argument
+ * @param[in] m order (1 or 2)
+ * @return phi_m(x)
+ */
+template<typename T>
+T PhiExp(const T& x, int m) {
+  using std::fabs;
+  using std::expm1;
+
+  if (fabs(x) < 0.5) {
+    // 16 terms: the remainder is below 1e-20 relative to phi_m.
+    const int N = 16;
+    double f = 1;  // (n + m)!
+    for (int k = 2; k <= N + m; k++) f *= k;
+    T result = 1 / f;
+    for (int n = N - 1; n >= 0; n--) {
+      f /= n + m + 1;
+      result = 1 / f - x * result;
+    }
+    return result;
+  }
+  if (m == 1) return -expm1(-x) / x;
+  return (x + expm1(-x)) / (x * x);
+}
+
+/**
+ * Integral over [0, x] of the sums of exponentials PolyExp returns
+ * after a bolus dose and during an infusion which starts at 0 and
+ * lasts at least x, that is of
+ *   dose * sum(i) a[i] * exp(-alpha[i] * t)
+ *   + rate * sum(i) a[i] * (1 - exp(-alpha[i] * t)) / alpha[i].
+ * It is computed in closed form (see PhiExp), including for
+ * alpha[i] * x close to 0.
+ *
+ * @param[in] x end of the interval (often time)
+ * @param[in] dose
+ * @param[in] rate
+ * @param[in] a relative unit to bolus
+ * @param[in] alpha unit
+ * @param[in] n number of terms in polyexponential
+ * @return integral of the sum of exponentials over [0, x]
+ */
+template<typename T_x, typename T_dose, typename T_rate, typename T_a,
+  typename T_alpha>
+typename boost::math::tools::promote_args<T_x, T_dose, T_rate, T_a,
+  T_alpha>::type
+PolyExpIntegral(const T_x& x,
+                const T_dose& dose,
+                const T_rate& rate,
+                const std::vector<T_a>& a,
+                const std::vector<T_alpha>& alpha,
+                const int& n) {
+  typedef typename boost::math::tools::promote_args<T_x, T_dose, T_rate,
+    T_a, T_alpha>::type scalar;
+
+  assert((alpha.size() >= (size_t) n) && (a.size() >= (size_t) n));
+
+  scalar result = 0;
+  for (int i = 0; i < n; i++) {
+    typename boost::math::tools::promote_args<T_x, T_alpha>::type
+      ax = alpha[i] * x;
+    result += a[i] * (dose * x * PhiExp(ax, 1)
+                      + rate * x * x * PhiExp(ax, 2));
+  }
+  return result;
+}
+
 }
 
 #endif
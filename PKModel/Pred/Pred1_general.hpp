@@ -3,7 +3,9 @@
 
 #include <stan/math/torsten/PKModel/integrator.hpp>
 #include <stan/math/torsten/PKModel/Pred/unpromote.hpp>
+#include <stan/math/torsten/PKModel/Pred/time_sensitivity.hpp>
 #include <stan/math/torsten/PKModel/functors/functor.hpp>
+#include <stan/math/torsten/PKModel/functors/auc_functor.hpp>
 #include <stan/math/prim/mat/fun/to_array_1d.hpp>
 #include <iostream>
 #include <vector>
@@ -80,8 +82,9 @@ struct Pred1_general {
     T_time EventTime = parameter.get_time();  // time of current event
     T_time InitTime = EventTime - dt;  // time of previous event
 
-    // Convert time parameters to fixed data for ODE integrator
-    // FIX ME - see issue #30
+    // The integrator takes the times as fixed data: their
+    // sensitivities are added through the right hand side of the ODE
+    // at the ends of the interval (see add_time_sensitivity).
     vector<double> EventTime_d(1, unpromote(EventTime));
     double InitTime_d = unpromote(InitTime);
 
@@ -92,11 +95,15 @@ struct Pred1_general {
     if (EventTime_d[0] == InitTime_d) { pred = init;
     } else {
       vector<int> idummy;
+      ode_rate_dbl_functor<F> f(f_);
+      add_time_sensitivity(f, InitTime_d, InitTime, -1, init_vector, theta,
+                           rate);
       vector<vector<scalar> >
-        pred_V = integrator_(ode_rate_dbl_functor<F>(f_),
-                             init_vector, InitTime_d,
+        pred_V = integrator_(f, init_vector, InitTime_d,
                              EventTime_d, theta, rate,
                              idummy);
+      add_time_sensitivity(f, EventTime_d[0], EventTime, 1, pred_V[0], theta,
+                           rate);
 
       // Convert vector in row-major vector (eigen Matrix)
       pred.resize(pred_V[0].size());
@@ -136,8 +143,7 @@ struct Pred1_general {
     T_time EventTime = parameter.get_time();  // time of current event
     T_time InitTime = EventTime - dt;  // time of previous event
 
-    // Convert time parameters to fixed data for ODE integrator
-    // FIX ME - see issue #30
+    // The integrator takes the times as fixed data (see above).
     vector<double> EventTime_d(1, unpromote(EventTime));
     double InitTime_d = unpromote(InitTime);
 
@@ -157,11 +163,15 @@ struct Pred1_general {
     if (EventTime_d[0] == InitTime_d) { pred = init;
     } else {
       vector<int> idummy;
+      ode_rate_var_functor<F> f(f_);
+      add_time_sensitivity(f, InitTime_d, InitTime, -1, init_vector, theta,
+                           x_r);
       vector<vector<scalar> >
-        pred_V = integrator_(ode_rate_var_functor<F>(f_),
-                             init_vector, InitTime_d,
+        pred_V = integrator_(f, init_vector, InitTime_d,
                              EventTime_d, theta, x_r,
                              idummy);
+      add_time_sensitivity(f, EventTime_d[0], EventTime, 1, pred_V[0], theta,
+                           x_r);
 
       // Convert vector in row-major vector (eigen Matrix)
       // FIX ME - want to return column-major vector to use Stan's
@@ -173,6 +183,43 @@ struct Pred1_general {
   }
 };
 
+/**
+ * Amounts and AUCs over dt for the general compartment model, for
+ * Pred with AUC outputs. One quadrature state per AUC is appended
+ * to the ODE system (see auc_functor), which is integrated with the
+ * same integrator as the amounts.
+ */
+template<typename F, typename T_time, typename T_parameters,
+         typename T_biovar, typename T_tlag, typename T_init,
+         typename T_rate>
+void Pred1AUC(const Pred1_general<F>& Pred1,
+              const T_time& dt,
+              const ModelParameters<T_time, T_parameters, T_biovar,
+                                    T_tlag>& parameter,
+              const Eigen::Matrix<T_init, 1, Eigen::Dynamic>& init,
+              const std::vector<T_rate>& rate,
+              const std::vector<int>& cmts,
+              Eigen::Matrix<T_init, Eigen::Dynamic, 1>& pred,
+              Eigen::Matrix<T_init, 1, Eigen::Dynamic>& auc) {
+  using Eigen::Matrix;
+  using Eigen::Dynamic;
+
+  int nCmt = init.cols(), nAuc = cmts.size();
+  Matrix<T_init, 1, Dynamic> init_auc
+    = Matrix<T_init, 1, Dynamic>::Zero(nCmt + nAuc);
+  init_auc.head(nCmt) = init;
+  std::vector<T_rate> rate_auc(rate);
+  rate_auc.resize(nCmt + nAuc, 0);
+
+  Pred1_general<auc_functor<F> >
+    Pred1_auc(auc_functor<F>(Pred1.f_, nCmt, cmts), Pred1.integrator_);
+  Matrix<T_init, Dynamic, 1> pred_auc
+    = Pred1_auc(dt, parameter, init_auc, rate_auc);
+
+  pred = pred_auc.head(nCmt);
+  auc = pred_auc.tail(nAuc).transpose();
+}
+
 }
 
 #endif
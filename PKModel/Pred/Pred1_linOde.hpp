@@ -1,6 +1,8 @@
 #ifndef STAN_MATH_TORSTEN_PKMODEL_PRED_PRED1_LINODE_HPP
 #define STAN_MATH_TORSTEN_PKMODEL_PRED_PRED1_LINODE_HPP
 
+#include <stan/math/torsten/PKModel/thread_safe_pred.hpp>
+#include <stan/math/torsten/PKModel/preserves_zero_state.hpp>
 #include <stan/math/prim/mat/fun/mdivide_left.hpp>
 #include <stan/math/rev/mat/fun/mdivide_left.hpp>
 #include <stan/math/rev/mat/fun/multiply.hpp>
@@ -85,6 +87,62 @@ struct Pred1_linOde {
   }
 };
 
+template <>
+struct thread_safe_pred<Pred1_linOde> : boost::true_type { };
+
+template <>
+struct preserves_zero_state<Pred1_linOde> : boost::true_type { };
+
+/**
+ * Amounts and AUCs over dt for the linear compartment model, for
+ * Pred with AUC outputs.
+ *
+ * The system is augmented with a constant state holding the rates
+ * and with one state per AUC, whose derivative is the amount in
+ * the compartment. The matrix exponential of the augmented system
+ * gives the amounts and the AUCs at once, without requiring the
+ * system matrix to be invertible.
+ */
+template<typename T_time, typename T_parameters, typename T_biovar,
+         typename T_tlag, typename T_init, typename T_rate>
+void Pred1AUC(const Pred1_linOde& Pred1,
+              const T_time& dt,
+              const ModelParameters<T_time, T_parameters, T_biovar,
+                                    T_tlag>& parameter,
+              const Eigen::Matrix<T_init, 1, Eigen::Dynamic>& init,
+              const std::vector<T_rate>& rate,
+              const std::vector<int>& cmts,
+              Eigen::Matrix<T_init, Eigen::Dynamic, 1>& pred,
+              Eigen::Matrix<T_init, 1, Eigen::Dynamic>& auc) {
+  using Eigen::Matrix;
+  using Eigen::Dynamic;
+  using stan::math::matrix_exp;
+
+  int nCmt = init.cols(), nAuc = cmts.size(), n = nCmt + 1 + nAuc;
+  if (dt == 0) {
+    pred = init;
+    auc = Matrix<T_init, 1, Dynamic>::Zero(nAuc);
+    return;
+  }
+
+  Matrix<T_parameters, Dynamic, Dynamic> system = parameter.get_K();
+  Matrix<T_init, Dynamic, Dynamic> dt_system
+    = Matrix<T_init, Dynamic, Dynamic>::Zero(n, n);
+  for (int i = 0; i < nCmt; i++) {
+    for (int j = 0; j < nCmt; j++) dt_system(i, j) = system(i, j) * dt;
+    dt_system(i, nCmt) = rate[i] * dt;
+  }
+  for (int k = 0; k < nAuc; k++) dt_system(nCmt + 1 + k, cmts[k] - 1) = dt;
+
+  Matrix<T_init, Dynamic, 1> x = Matrix<T_init, Dynamic, 1>::Zero(n);
+  x.head(nCmt) = init.transpose();
+  x(nCmt) = 1;
+  x = matrix_exp(dt_system) * x;
+
+  pred = x.head(nCmt);
+  auc = x.tail(nAuc).transpose();
+}
+
 }
 
 #endif
@@ -2,6 +2,7 @@
 #define STAN_MATH_TORSTEN_PKMODEL_PRED_PRED1_MIX2_HPP
 
 #include <stan/math/torsten/PKModel/Pred/unpromote.hpp>
+#include <stan/math/torsten/PKModel/Pred/time_sensitivity.hpp>
 #include <stan/math/torsten/PKModel/Pred/fTwoCpt.hpp>
 #include <stan/math/torsten/PKModel/integrator.hpp>
 #include <iostream>
@@ -74,7 +75,10 @@ struct Pred1_mix2 {
 
     assert((size_t) init.cols() == rate.size());
 
-    // pass fixed times to the integrator. FIX ME - see issue #30
+    // pass fixed times to the integrator. The PD states only depend on
+    // the times through dt, since the user functor is passed the time
+    // since t0 (see mix2_functor): the sensitivity to dt is added from the
+    // right hand side of the ODE at the end of the interval.
     T_time t = parameter.get_time();  // time of current event
     T_time t0 = t - dt;  // time of previous event
     vector<double> t_dbl(1, unpromote(t));
@@ -117,10 +121,10 @@ struct Pred1_mix2 {
       for (size_t i = 0; i < nPD; i++) y0_PD[i] = y0[nPK + i];
       vector<int> idummy;
 
+      ode_rate_dbl_functor<F> f(f_);
       vector<vector<scalar> >
-        pred_V = integrator_(ode_rate_dbl_functor<F>(f_),
-                             y0_PD, t0_dbl, t_dbl,
-                             theta, x_r, idummy);
+        pred_V = integrator_(f, y0_PD, t0_dbl, t_dbl, theta, x_r, idummy);
+      add_time_sensitivity(f, t_dbl[0], dt, 1, pred_V[0], theta, x_r);
       size_t nOde = pred_V[0].size();
 
       pred.resize(nPK + nOde);
@@ -165,7 +169,10 @@ struct Pred1_mix2 {
 
     assert((size_t) init.cols() == rate.size());
 
-    // pass fixed times to the integrator. FIX ME - see issue #30
+    // pass fixed times to the integrator. The PD states only depend on
+    // the times through dt, since the user functor is passed the time
+    // since t0 (see mix2_functor): the sensitivity to dt is added from the
+    // right hand side of the ODE at the end of the interval.
     T_time t = parameter.get_time();
     T_time t0 = t - dt;
     vector<double> t_dbl(1, unpromote(t));
@@ -211,10 +218,10 @@ struct Pred1_mix2 {
       x_r[0] = nPK;
       x_r[1] = t0_dbl;
 
+      ode_rate_var_functor<F> f(f_);
       vector<vector<scalar> >
-        pred_V = integrator_(ode_rate_var_functor<F>(f_),
-                             y0_PD, t0_dbl, t_dbl,
-                             theta, x_r, idummy);
+        pred_V = integrator_(f, y0_PD, t0_dbl, t_dbl, theta, x_r, idummy);
+      add_time_sensitivity(f, t_dbl[0], dt, 1, pred_V[0], theta, x_r);
       size_t nOde = pred_V[0].size();
 
       pred.resize(nPK + nOde);
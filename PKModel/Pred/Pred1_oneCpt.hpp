@@ -1,6 +1,8 @@
 #ifndef STAN_MATH_TORSTEN_PKMODEL_PRED_PRED1_ONECPT_HPP
 #define STAN_MATH_TORSTEN_PKMODEL_PRED_PRED1_ONECPT_HPP
 
+#include <stan/math/torsten/PKModel/thread_safe_pred.hpp>
+#include <stan/math/torsten/PKModel/preserves_zero_state.hpp>
 #include <stan/math/torsten/PKModel/Pred/PolyExp.hpp>
 #include <iostream>
 #include <vector>
@@ -80,6 +82,75 @@ struct Pred1_oneCpt {
   }
 };
 
+template <>
+struct thread_safe_pred<Pred1_oneCpt> : boost::true_type { };
+
+template <>
+struct preserves_zero_state<Pred1_oneCpt> : boost::true_type { };
+
+/**
+ * Amounts and AUCs over dt for the one compartment model, for Pred
+ * with AUC outputs.
+ *
+ * The AUCs are the integrals over dt of the sums of exponentials
+ * of the amounts (see PolyExpIntegral), with the same terms as in
+ * Pred1_oneCpt. They do not cancel when the rate constants times dt
+ * are small (slow elimination or frequent events), unlike the AUCs
+ * inferred from the change of the amounts.
+ *
+ * @param[in] Pred1 functor computing the amounts
+ * @param[in] dt time between current and previous event
+ * @param[in] parameter model parameters at current event
+ * @param[in] init amount in each compartment at previous event
+ * @param[in] rate rate in each compartment
+ * @param[in] cmts compartments (starting at 1) of the AUCs
+ * @param[out] pred amount in each compartment at the current event
+ * @param[out] auc integral over dt of the amount in each compartment
+ * of cmts
+ */
+template<typename T_time, typename T_parameters, typename T_biovar,
+         typename T_tlag, typename T_init, typename T_rate>
+void Pred1AUC(const Pred1_oneCpt& Pred1,
+              const T_time& dt,
+              const ModelParameters<T_time, T_parameters, T_biovar,
+                                    T_tlag>& parameter,
+              const Eigen::Matrix<T_init, 1, Eigen::Dynamic>& init,
+              const std::vector<T_rate>& rate,
+              const std::vector<int>& cmts,
+              Eigen::Matrix<T_init, Eigen::Dynamic, 1>& pred,
+              Eigen::Matrix<T_init, 1, Eigen::Dynamic>& auc) {
+  using std::vector;
+  pred = Pred1(dt, parameter, init, rate);
+
+  T_parameters CL = parameter.get_RealParameters()[0],
+    V2 = parameter.get_RealParameters()[1],
+    ka = parameter.get_RealParameters()[2];
+
+  T_parameters k10 = CL / V2;
+  vector<T_parameters> alpha(2, 0);
+  alpha[0] = k10;
+  alpha[1] = ka;
+  vector<T_parameters> alpha_ka(1, ka);
+
+  vector<T_parameters> a(2, 0);
+  T_init auc_cmt[2] = {0, 0};
+
+  if ((init[0] != 0) || (rate[0] != 0)) {
+    a[0] = 1;
+    auc_cmt[0] = PolyExpIntegral(dt, init[0], rate[0], a, alpha_ka, 1);
+    a[0] = ka / (ka - alpha[0]);
+    a[1] = -a[0];
+    auc_cmt[1] += PolyExpIntegral(dt, init[0], rate[0], a, alpha, 2);
+  }
+
+  if ((init[1] != 0) || (rate[1] != 0)) {
+    a[0] = 1;
+    auc_cmt[1] += PolyExpIntegral(dt, init[1], rate[1], a, alpha, 1);
+  }
+
+  auc.resize(cmts.size());
+  for (size_t i = 0; i < cmts.size(); i++) auc(i) = auc_cmt[cmts[i] - 1];
+}
 }
 
 #endif
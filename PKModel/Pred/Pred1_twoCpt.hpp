@@ -1,6 +1,8 @@
 #ifndef STAN_MATH_TORSTEN_PKMODEL_PRED_PRED1_TWOCPT_HPP
 #define STAN_MATH_TORSTEN_PKMODEL_PRED_PRED1_TWOCPT_HPP
 
+#include <stan/math/torsten/PKModel/thread_safe_pred.hpp>
+#include <stan/math/torsten/PKModel/preserves_zero_state.hpp>
 #include <stan/math/torsten/PKModel/Pred/PolyExp.hpp>
 #include <iostream>
 #include <vector>
@@ -106,5 +108,84 @@ struct Pred1_twoCpt {
   }
 };
 
+template <>
+struct thread_safe_pred<Pred1_twoCpt> : boost::true_type { };
+
+template <>
+struct preserves_zero_state<Pred1_twoCpt> : boost::true_type { };
+
+/**
+ * Amounts and AUCs over dt for the two compartment model, for Pred
+ * with AUC outputs. The AUCs are the integrals of the sums of
+ * exponentials of the amounts, with the same terms as in
+ * Pred1_twoCpt (see the one compartment model).
+ */
+template<typename T_time, typename T_parameters, typename T_biovar,
+         typename T_tlag, typename T_init, typename T_rate>
+void Pred1AUC(const Pred1_twoCpt& Pred1,
+              const T_time& dt,
+              const ModelParameters<T_time, T_parameters, T_biovar,
+                                    T_tlag>& parameter,
+              const Eigen::Matrix<T_init, 1, Eigen::Dynamic>& init,
+              const std::vector<T_rate>& rate,
+              const std::vector<int>& cmts,
+              Eigen::Matrix<T_init, Eigen::Dynamic, 1>& pred,
+              Eigen::Matrix<T_init, 1, Eigen::Dynamic>& auc) {
+  using std::vector;
+  pred = Pred1(dt, parameter, init, rate);
+
+  T_parameters CL = parameter.get_RealParameters()[0],
+    Q = parameter.get_RealParameters()[1],
+    V2 = parameter.get_RealParameters()[2],
+    V3 = parameter.get_RealParameters()[3],
+    ka = parameter.get_RealParameters()[4];
+  T_parameters k10 = CL / V2,
+    k12 = Q / V2,
+    k21 = Q / V3,
+    ksum = k10 + k12 + k21;
+
+  vector<T_parameters> alpha(3, 0);
+  alpha[0] = (ksum + sqrt(ksum * ksum - 4 * k10 * k21)) / 2;
+  alpha[1] = (ksum - sqrt(ksum * ksum - 4 * k10 * k21)) / 2;
+  alpha[2] = ka;
+  vector<T_parameters> alpha_ka(1, ka);
+
+  vector<T_parameters> a(3, 0);
+  T_init auc_cmt[3] = {0, 0, 0};
+
+  if ((init[0] != 0) || (rate[0] != 0))  {
+    a[0] = 1;
+    auc_cmt[0] = PolyExpIntegral(dt, init[0], rate[0], a, alpha_ka, 1);
+    a[0] = ka * (k21 - alpha[0]) / ((ka - alpha[0]) * (alpha[1] - alpha[0]));
+    a[1] = ka * (k21 - alpha[1]) / ((ka - alpha[1]) * (alpha[0] - alpha[1]));
+    a[2] = -(a[0] + a[1]);
+    auc_cmt[1] += PolyExpIntegral(dt, init[0], rate[0], a, alpha, 3);
+    a[0] = ka * k12 / ((ka - alpha[0]) * (alpha[1] - alpha[0]));
+    a[1] = ka * k12 / ((ka - alpha[1]) * (alpha[0] - alpha[1]));
+    a[2] = -(a[0] + a[1]);
+    auc_cmt[2] += PolyExpIntegral(dt, init[0], rate[0], a, alpha, 3);
+  }
+
+  if ((init[1] != 0) || (rate[1] != 0)) {
+    a[0] = (k21 - alpha[0]) / (alpha[1] - alpha[0]);
+    a[1] = (k21 - alpha[1]) / (alpha[0] - alpha[1]);
+    auc_cmt[1] += PolyExpIntegral(dt, init[1], rate[1], a, alpha, 2);
+    a[0] = k12 / (alpha[1] - alpha[0]);
+    a[1] = -a[0];
+    auc_cmt[2] += PolyExpIntegral(dt, init[1], rate[1], a, alpha, 2);
+  }
+
+  if ((init[2] != 0) || (rate[2] != 0)) {
+    a[0] = k21 / (alpha[1] - alpha[0]);
+    a[1] = -a[0];
+    auc_cmt[1] += PolyExpIntegral(dt, init[2], rate[2], a, alpha, 2);
+    a[0] = (k10 + k12 - alpha[0]) / (alpha[1] - alpha[0]);
+    a[1] = (k10 + k12 - alpha[1]) / (alpha[0] - alpha[1]);
+    auc_cmt[2] += PolyExpIntegral(dt, init[2], rate[2], a, alpha, 2);
+  }
+
+  auc.resize(cmts.size());
+  for (size_t i = 0; i < cmts.size(); i++) auc(i) = auc_cmt[cmts[i] - 1];
+}
 }
 #endif
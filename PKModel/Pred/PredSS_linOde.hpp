@@ -1,6 +1,7 @@
 #ifndef STAN_MATH_TORSTEN_PKMODEL_PRED_PREDSS_LINODE_HPP
 #define STAN_MATH_TORSTEN_PKMODEL_PRED_PREDSS_LINODE_HPP
 
+#include <stan/math/torsten/PKModel/thread_safe_pred.hpp>
 #include <stan/math/torsten/PKModel/functors/check_mti.hpp>
 #include <stan/math/rev/mat/fun/mdivide_left.hpp>
 #include <stan/math/rev/mat/fun/multiply.hpp>
@@ -105,6 +106,9 @@ struct PredSS_linOde {
   }
 };
 
+template <>
+struct thread_safe_pred<PredSS_linOde> : boost::true_type { };
+
 }
 
 #endif
@@ -1,6 +1,7 @@
 #ifndef STAN_MATH_TORSTEN_PKMODEL_PRED_PREDSS_ONECPT_HPP
 #define STAN_MATH_TORSTEN_PKMODEL_PRED_PREDSS_ONECPT_HPP
 
+#include <stan/math/torsten/PKModel/thread_safe_pred.hpp>
 #include <stan/math/torsten/PKModel/Pred/PolyExp.hpp>
 #include <stan/math/torsten/PKModel/functors/check_mti.hpp>
 #include <iostream>
@@ -108,5 +109,8 @@ struct PredSS_oneCpt {
   }
 };
 
+template <>
+struct thread_safe_pred<PredSS_oneCpt> : boost::true_type { };
+
 }
 #endif
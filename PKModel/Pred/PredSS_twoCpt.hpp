@@ -1,6 +1,7 @@
 #ifndef STAN_MATH_TORSTEN_PKMODEL_PRED_PREDSS_TWOCPT_HPP
 #define STAN_MATH_TORSTEN_PKMODEL_PRED_PREDSS_TWOCPT_HPP
 
+#include <stan/math/torsten/PKModel/thread_safe_pred.hpp>
 #include <stan/math/torsten/PKModel/Pred/PolyExp.hpp>
 #include <iostream>
 #include <vector>
@@ -167,5 +168,8 @@ struct PredSS_twoCpt {
   }
 };
 
+template <>
+struct thread_safe_pred<PredSS_twoCpt> : boost::true_type { };
+
 }
 #endif
@@ -0,0 +1,56 @@
+#ifndef STAN_MATH_TORSTEN_PKMODEL_PRED_TIME_SENSITIVITY_HPP
+#define STAN_MATH_TORSTEN_PKMODEL_PRED_TIME_SENSITIVITY_HPP
+
+#include <stan/math/torsten/PKModel/Pred/unpromote.hpp>
+#include <vector>
+
+namespace torsten {
+
+/**
+ * The ODE integrators take the initial and output times as data.
+ * When these times are autodiff variables (for instance because of
+ * lag times), the sensitivities of the states with respect to them
+ * follow from the right hand side f of the ODE at the end points
+ * of the interval (t0, t1):
+ *    dy(t1) / dt1 = f(t1, y(t1))
+ *    dy(t1) / dt0 = - dy(t1) / dy(t0) * f(t0, y(t0))
+ *
+ * This function adds to the states y the term
+ * sign * f(t, y) * (tau - value(tau)), which is zero but whose
+ * derivative with respect to tau is sign * f(t, y). Applied to the
+ * output states with tau = t1 and sign = 1, it gives the first
+ * sensitivity; applied to the initial states with tau = t0 and
+ * sign = -1, before the integration, it gives the second one, the
+ * integrator propagating the derivative of the initial states.
+ *
+ * Nothing is done when tau is not an autodiff variable.
+ *
+ * @tparam F type of the ODE right hand side functor
+ * @tparam T_y type of scalar for the states
+ * @tparam T_tau type of scalar for the time
+ * @tparam T_theta type of scalar for the ODE parameters
+ * @param[in] f right hand side of the ODE
+ * @param[in] t time at which f is evaluated
+ * @param[in] tau time whose sensitivity is added
+ * @param[in] sign sign of the sensitivity
+ * @param[in, out] y states
+ * @param[in] theta ODE parameters
+ * @param[in] x_r real data of the ODE
+ */
+template <typename F, typename T_y, typename T_tau, typename T_theta>
+inline void add_time_sensitivity(const F& f, double t, const T_tau& tau,
+                                 double sign, std::vector<T_y>& y,
+                                 const std::vector<T_theta>& theta,
+                                 const std::vector<double>& x_r) {
+  if (stan::is_constant_struct<T_tau>::value) return;
+
+  std::vector<int> idummy;
+  std::vector<double> dydt = f(t, unpromote(y), unpromote(theta), x_r,
+                               idummy, 0);
+  T_tau dtau = tau - unpromote(tau);
+  for (size_t i = 0; i < y.size(); i++) y[i] += sign * dydt[i] * dtau;
+}
+
+}
+
+#endif
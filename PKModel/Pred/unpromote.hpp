@@ -11,8 +11,10 @@ namespace torsten {
 
 /**
  * Functions that converts an autodiff variable into a double.
- * The variable will either be a stan::math::var
- * or a double (in which case it will not be modified).
+ * The variable will either be a stan::math::var, a
+ * stan::math::fvar, possibly nested (e.g. fvar<var> or
+ * fvar<fvar<double> >), or a double (in which case it will not
+ * be modified).
  *
  * @param[in] x the real to unpromote
  * @return the unpromoted real
@@ -20,22 +22,26 @@ namespace torsten {
 inline double unpromote(const stan::math::var& x) { return x.val(); }
 inline double unpromote(const double& x) { return x; }
 
+template <typename T>
+inline double unpromote(const stan::math::fvar<T>& x) {
+  return unpromote(x.val_);
+}
+
 /**
  * Unpromote a vector.
  *
+ * @tparam T scalar type of the vector
  * @param[in] x the vector of real to unpromote
  * return the unpromoted vector of reals
  */
+template <typename T>
 inline
 std::vector<double>
-unpromote(const std::vector<stan::math::var>& x) {
-  using std::vector;
-  using stan::math::var;
-
+unpromote(const std::vector<T>& x) {
   size_t size_x = x.size();
-  vector<double> x_dbl(size_x);
+  std::vector<double> x_dbl(size_x);
   for (size_t i = 0; i < size_x; i++)
-    x_dbl[i] = x[i].val();
+    x_dbl[i] = unpromote(x[i]);
 
   return x_dbl;
 }
@@ -0,0 +1,377 @@
+#ifndef STAN_MATH_TORSTEN_PKMODEL_PREDCHECKPOINT_HPP
+#define STAN_MATH_TORSTEN_PKMODEL_PREDCHECKPOINT_HPP
+
+#include <stan/math/rev/core.hpp>
+#include <stan/math/rev/scal/meta/is_var.hpp>
+#include <stan/math/torsten/PKModel/PredSchedule.hpp>
+#include <boost/type_traits/integral_constant.hpp>
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace torsten {
+
+/**
+ * Opens a nested autodiff tape inside the chain() method of a vari.
+ *
+ * The reverse pass iterates over the autodiff stack while chain()
+ * is called, so that growing the stack from chain() could move it.
+ * The stack is swapped out for the lifetime of the object (which
+ * leaves the iterators of the reverse pass valid), and the nested
+ * tape is recovered before it is swapped back.
+ *
+ * This relies on the internals of the autodiff stack of Stan math
+ * 2.17: grad() iterates over ChainableStack::var_stack_ with
+ * iterators, and start_nested and recover_memory_nested (which the
+ * ODE integrators also call inside the nested tape) only use the
+ * stack past its current size. It must be checked again when
+ * moving to another version of Stan math, for instance with
+ * benchmark/checkpoint_check.cpp.
+ */
+class NestedTapeInChain {
+private:
+  std::vector<stan::math::vari*> stack_;
+
+  NestedTapeInChain(const NestedTapeInChain&);
+  NestedTapeInChain& operator=(const NestedTapeInChain&);
+
+public:
+  NestedTapeInChain() {
+    stack_.swap(stan::math::ChainableStack::var_stack_);
+    stan::math::start_nested();
+  }
+
+  ~NestedTapeInChain() {
+    stan::math::recover_memory_nested();
+    stack_.swap(stan::math::ChainableStack::var_stack_);
+  }
+};
+
+/**
+ * Data of a checkpointed sweep over an event schedule: the values
+ * of the parameters, and the amounts and AUCs at the first event of
+ * each segment of the schedule. It is deleted with the autodiff
+ * memory.
+ *
+ * The schedule is not copied: it must outlive the reverse pass.
+ */
+template <typename F_one, typename F_SS>
+struct PredCheckpointData : public stan::math::chainable_alloc {
+  const EventSchedule* schedule_;
+  F_one Pred1_;
+  F_SS PredSS_;
+  std::vector<std::vector<double> > pMatrix_, biovar_;
+  std::vector<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> >
+    system_;
+  std::vector<int> auc_cmt_;
+  int nCmt_, interval_;
+  std::vector<Eigen::Matrix<double, 1, Eigen::Dynamic> > init_, auc_;
+  std::vector<int> first_keep_;  // index of the first kept event
+
+  PredCheckpointData(const EventSchedule& schedule, const F_one& Pred1,
+                     const F_SS& PredSS, int nCmt,
+                     const std::vector<int>& auc_cmt, int interval)
+    : schedule_(&schedule), Pred1_(Pred1), PredSS_(PredSS),
+      auc_cmt_(auc_cmt), nCmt_(nCmt), interval_(interval) { }
+};
+
+/**
+ * Functors which copy the autodiff variables of the parameters into
+ * the operands of the checkpointed sweep, and add the adjoints of
+ * their recomputed copies to the operands. They skip data.
+ */
+struct push_operand {
+  void operator()(const stan::math::var& x,
+                  stan::math::vari**& operand) const {
+    *operand++ = x.vi_;
+  }
+  void operator()(double x, stan::math::vari**& operand) const { }
+};
+
+struct add_adjoint {
+  void operator()(const stan::math::var& x,
+                  stan::math::vari**& operand) const {
+    (*operand++)->adj_ += x.adj();
+  }
+  void operator()(double x, stan::math::vari**& operand) const { }
+};
+
+/**
+ * Vari of a checkpointed sweep over an event schedule. The amounts
+ * at the kept events are its outputs; in the reverse pass, the
+ * segments of the schedule are recomputed on a nested tape, from
+ * the last one to the first, starting from the amounts stored at
+ * their first event. The adjoints of the amounts at the start of a
+ * segment are passed to the previous segment.
+ */
+template <typename T_parameters, typename T_biovar,
+          typename F_one, typename F_SS>
+class PredCheckpointVari : public stan::math::vari {
+private:
+  PredCheckpointData<F_one, F_SS>* data_;
+  int nOperands_;
+  stan::math::vari** operands_;
+  stan::math::vari** outputs_;
+
+  template <typename T, typename F>
+  static void Visit(const std::vector<std::vector<T> >& x, F f,
+                    stan::math::vari**& operand) {
+    for (size_t i = 0; i < x.size(); i++)
+      for (size_t j = 0; j < x[i].size(); j++) f(x[i][j], operand);
+  }
+
+  template <typename T, typename F>
+  static void Visit(const std::vector<Eigen::Matrix<T, Eigen::Dynamic,
+                                                    Eigen::Dynamic> >& x,
+                    F f, stan::math::vari**& operand) {
+    for (size_t i = 0; i < x.size(); i++)
+      for (int j = 0; j < x[i].size(); j++) f(x[i](j), operand);
+  }
+
+public:
+  PredCheckpointVari(PredCheckpointData<F_one, F_SS>* data,
+                     const std::vector<std::vector<T_parameters> >& pMatrix,
+                     const std::vector<std::vector<T_biovar> >& biovar,
+                     const std::vector<Eigen::Matrix<T_parameters,
+                       Eigen::Dynamic, Eigen::Dynamic> >& system,
+                     const Eigen::Matrix<double, Eigen::Dynamic,
+                       Eigen::Dynamic>& pred)
+    : vari(0), data_(data), nOperands_(0) {
+    using stan::math::ChainableStack;
+    using stan::math::vari;
+
+    if (stan::is_var<T_parameters>::value) {
+      for (size_t i = 0; i < pMatrix.size(); i++)
+        nOperands_ += pMatrix[i].size();
+      for (size_t i = 0; i < system.size(); i++)
+        nOperands_ += system[i].size();
+    }
+    if (stan::is_var<T_biovar>::value)
+      for (size_t i = 0; i < biovar.size(); i++)
+        nOperands_ += biovar[i].size();
+
+    operands_ = ChainableStack::memalloc_.alloc_array<vari*>(nOperands_);
+    vari** operand = operands_;
+    Visit(pMatrix, push_operand(), operand);
+    Visit(biovar, push_operand(), operand);
+    Visit(system, push_operand(), operand);
+
+    outputs_ = ChainableStack::memalloc_.alloc_array<vari*>(pred.size());
+    for (int i = 0; i < pred.rows(); i++)
+      for (int j = 0; j < pred.cols(); j++)
+        outputs_[i * pred.cols() + j] = new vari(pred(i, j), false);
+  }
+
+  stan::math::var output(int i, int j) const {
+    return stan::math::var(outputs_[i * (data_->nCmt_
+                                         + data_->auc_cmt_.size()) + j]);
+  }
+
+  void chain() {
+    using Eigen::Matrix;
+    using Eigen::Dynamic;
+    using stan::math::var;
+    using std::vector;
+
+    const PredCheckpointData<F_one, F_SS>& d = *data_;
+    const EventSchedule& schedule = *d.schedule_;
+    int nCmt = d.nCmt_, nAuc = d.auc_cmt_.size(), nOut = nCmt + nAuc;
+    vector<double> adj(nOut, 0);  // adjoints at the end of the segment
+    const vector<double> no_rates(nCmt, 0);
+
+    for (int s = d.init_.size() - 1; s >= 0; s--) {
+      NestedTapeInChain nested;
+
+      vector<vector<T_parameters> > pMatrix(d.pMatrix_.size());
+      for (size_t i = 0; i < pMatrix.size(); i++)
+        pMatrix[i].assign(d.pMatrix_[i].begin(), d.pMatrix_[i].end());
+      vector<vector<T_biovar> > biovar(d.biovar_.size());
+      for (size_t i = 0; i < biovar.size(); i++)
+        biovar[i].assign(d.biovar_[i].begin(), d.biovar_[i].end());
+      vector<Matrix<T_parameters, Dynamic, Dynamic> >
+        system(d.system_.size());
+      for (size_t i = 0; i < system.size(); i++)
+        system[i] = d.system_[i].template cast<T_parameters>();
+
+      Matrix<var, 1, Dynamic> init0 = d.init_[s].template cast<var>(),
+        auc0 = d.auc_[s].template cast<var>();
+      Matrix<var, 1, Dynamic> init = init0, auc = auc0;
+      vector<T_biovar> rate2(nCmt);
+
+      // the adjoints of the outputs are back-propagated through
+      // the sum of the outputs weighted by their adjoints.
+      var sum = 0;
+      int begin = s * d.interval_,
+        end = std::min(begin + d.interval_, schedule.get_size()),
+        ikeep = d.first_keep_[s];
+      ScheduleParameters<T_parameters, T_biovar>
+        parameters(schedule, pMatrix, biovar, system);
+      for (EventSchedule::Cursor event(schedule, begin);
+           event.get_index() < end; event.Next()) {
+        PredEvent(schedule, event, parameters, nCmt, d.Pred1_, d.PredSS_,
+                  d.auc_cmt_, no_rates, rate2, init, auc);
+        if (event.get_keep()) {
+          for (int j = 0; j < nOut; j++) {
+            double adj_j = outputs_[ikeep * nOut + j]->adj_;
+            if (adj_j != 0) sum += adj_j * (j < nCmt ? init(j)
+                                            : auc(j - nCmt));
+          }
+          ikeep++;
+        }
+      }
+      for (int j = 0; j < nOut; j++)
+        if (adj[j] != 0) sum += adj[j] * (j < nCmt ? init(j) : auc(j - nCmt));
+
+      sum.grad();
+
+      for (int j = 0; j < nCmt; j++) adj[j] = init0(j).adj();
+      for (int j = 0; j < nAuc; j++) adj[nCmt + j] = auc0(j).adj();
+      stan::math::vari** operand = operands_;
+      Visit(pMatrix, add_adjoint(), operand);
+      Visit(biovar, add_adjoint(), operand);
+      Visit(system, add_adjoint(), operand);
+    }
+  }
+};
+
+/**
+ * Sweep over a compiled event schedule which keeps the autodiff
+ * tape of a single segment of the schedule at a time, for
+ * schedules with many events (see
+ * EventSchedule::set_checkpoint_interval).
+ *
+ * The forward sweep is done with the values of the parameters, and
+ * stores the amounts at the first event of each segment of k
+ * events. The reverse pass recomputes each segment on a nested
+ * tape. Each segment is thus computed twice, but the memory grows
+ * as N / k + k instead of N for N events, that is as the square
+ * root of N for k close to the square root of N.
+ *
+ * When the parameters are data (or forward mode autodiff
+ * variables), there is no tape and the schedule is swept as usual.
+ * Otherwise the schedule is read again in the reverse pass, and
+ * must outlive it (and not be modified before it).
+ */
+template<typename T_parameters,
+         typename T_biovar,
+         typename F_one,
+         typename F_SS>
+Eigen::Matrix<typename boost::math::tools::promote_args<T_parameters,
+  T_biovar>::type, Eigen::Dynamic, Eigen::Dynamic>
+PredCheckpoint(const EventSchedule& schedule,
+               const std::vector<std::vector<T_parameters> >& pMatrix,
+               const std::vector<std::vector<T_biovar> >& biovar,
+               int nCmt,
+               const std::vector<Eigen::Matrix<T_parameters,
+                 Eigen::Dynamic, Eigen::Dynamic> >& system,
+               const F_one& Pred1,
+               const F_SS& PredSS,
+               const std::vector<int>& auc_cmt,
+               boost::false_type) {
+  return PredSweep(schedule, pMatrix, biovar, nCmt, system, Pred1, PredSS,
+                   0, auc_cmt);
+}
+
+template<typename T_parameters,
+         typename T_biovar,
+         typename F_one,
+         typename F_SS>
+Eigen::Matrix<stan::math::var, Eigen::Dynamic, Eigen::Dynamic>
+PredCheckpoint(const EventSchedule& schedule,
+               const std::vector<std::vector<T_parameters> >& pMatrix,
+               const std::vector<std::vector<T_biovar> >& biovar,
+               int nCmt,
+               const std::vector<Eigen::Matrix<T_parameters,
+                 Eigen::Dynamic, Eigen::Dynamic> >& system,
+               const F_one& Pred1,
+               const F_SS& PredSS,
+               const std::vector<int>& auc_cmt,
+               boost::true_type) {
+  using Eigen::Matrix;
+  using Eigen::Dynamic;
+  using std::vector;
+
+  int nEvent = schedule.get_size(), nAuc = auc_cmt.size();
+  int interval = schedule.get_checkpoint_interval();
+  if (interval < 0)
+    interval = static_cast<int>(std::ceil(std::sqrt(nEvent)));
+  interval = std::max(interval, 1);
+
+  PredCheckpointData<F_one, F_SS>* data
+    = new PredCheckpointData<F_one, F_SS>(schedule, Pred1, PredSS, nCmt,
+                                          auc_cmt, interval);
+  data->pMatrix_.resize(pMatrix.size());
+  for (size_t i = 0; i < pMatrix.size(); i++)
+    data->pMatrix_[i] = unpromote(pMatrix[i]);
+  data->biovar_.resize(biovar.size());
+  for (size_t i = 0; i < biovar.size(); i++)
+    data->biovar_[i] = unpromote(biovar[i]);
+  data->system_.resize(system.size());
+  for (size_t i = 0; i < system.size(); i++) {
+    data->system_[i].resize(system[i].rows(), system[i].cols());
+    for (int j = 0; j < system[i].size(); j++)
+      data->system_[i](j) = unpromote(system[i](j));
+  }
+
+  // FORWARD SWEEP WITH THE VALUES OF THE PARAMETERS
+  Matrix<double, 1, Dynamic> init = Matrix<double, 1, Dynamic>::Zero(nCmt);
+  Matrix<double, 1, Dynamic> auc = Matrix<double, 1, Dynamic>::Zero(nAuc);
+  Matrix<double, Dynamic, Dynamic> pred(schedule.get_nKeep(), nCmt + nAuc);
+  vector<double> rate2(nCmt);
+  const vector<double> no_rates(nCmt, 0);
+  ScheduleParameters<double, double>
+    parameters(schedule, data->pMatrix_, data->biovar_, data->system_);
+  int ikeep = 0;
+
+  for (EventSchedule::Cursor event(schedule, 0); !event.done();
+       event.Next()) {
+    if (event.get_index() % interval == 0) {
+      data->init_.push_back(init);
+      data->auc_.push_back(auc);
+      data->first_keep_.push_back(ikeep);
+    }
+    PredEvent(schedule, event, parameters, nCmt, Pred1, PredSS, auc_cmt,
+              no_rates, rate2, init, auc);
+    if (event.get_keep()) {
+      pred.block(ikeep, 0, 1, nCmt) = init;
+      if (nAuc > 0) pred.block(ikeep, nCmt, 1, nAuc) = auc;
+      ikeep++;
+    }
+  }
+
+  PredCheckpointVari<T_parameters, T_biovar, F_one, F_SS>* vi
+    = new PredCheckpointVari<T_parameters, T_biovar, F_one, F_SS>
+        (data, pMatrix, biovar, system, pred);
+  Matrix<stan::math::var, Dynamic, Dynamic> result(pred.rows(), pred.cols());
+  for (int i = 0; i < pred.rows(); i++)
+    for (int j = 0; j < pred.cols(); j++) result(i, j) = vi->output(i, j);
+  return result;
+}
+
+template<typename T_parameters,
+         typename T_biovar,
+         typename F_one,
+         typename F_SS>
+Eigen::Matrix<typename boost::math::tools::promote_args<T_parameters,
+  T_biovar>::type, Eigen::Dynamic, Eigen::Dynamic>
+PredCheckpoint(const EventSchedule& schedule,
+               const std::vector<std::vector<T_parameters> >& pMatrix,
+               const std::vector<std::vector<T_biovar> >& biovar,
+               int nCmt,
+               const std::vector<Eigen::Matrix<T_parameters,
+                 Eigen::Dynamic, Eigen::Dynamic> >& system,
+               const F_one& Pred1,
+               const F_SS& PredSS,
+               const std::vector<int>& auc_cmt) {
+  typedef typename boost::math::tools::promote_args<T_parameters,
+    T_biovar>::type scalar;
+  return PredCheckpoint(schedule, pMatrix, biovar, nCmt, system, Pred1,
+                        PredSS, auc_cmt,
+                        boost::integral_constant<bool,
+                          stan::is_var<scalar>::value>());
+}
+
+}
+
+#endif
@@ -0,0 +1,217 @@
+#ifndef STAN_MATH_TORSTEN_PKMODEL_PREDCONCURRENT_HPP
+#define STAN_MATH_TORSTEN_PKMODEL_PREDCONCURRENT_HPP
+
+#include <stan/math/torsten/PKModel/PredSchedule.hpp>
+#include <stan/math/torsten/PKModel/thread_safe_pred.hpp>
+#include <boost/type_traits/integral_constant.hpp>
+#include <boost/type_traits/is_same.hpp>
+#include <Eigen/Dense>
+#include <algorithm>
+#include <exception>
+#include <thread>
+#include <vector>
+
+namespace torsten {
+
+/**
+ * Computes the segments of a compiled event schedule which are
+ * handed to one thread of PredConcurrent (segments k, k + n,
+ * k + 2n, ... for thread k of n), and writes their predictions in
+ * the rows of pred of their kept events. An exception thrown by
+ * the model is stored, to be rethrown on the calling thread.
+ */
+template<typename F_one, typename F_SS>
+struct PredSegmentWorker {
+  const EventSchedule& schedule_;
+  const std::vector<std::vector<double> >& pMatrix_;
+  const std::vector<std::vector<double> >& biovar_;
+  int nCmt_;
+  const std::vector<Eigen::MatrixXd>& system_;
+  const F_one& Pred1_;
+  const F_SS& PredSS_;
+  const std::vector<int>& auc_cmt_;
+  const std::vector<int>& segments_;
+  const std::vector<int>& first_keep_;
+  int thread_, nThreads_;
+  Eigen::MatrixXd& pred_;
+  std::exception_ptr& error_;
+
+  PredSegmentWorker(const EventSchedule& schedule,
+                    const std::vector<std::vector<double> >& pMatrix,
+                    const std::vector<std::vector<double> >& biovar,
+                    int nCmt,
+                    const std::vector<Eigen::MatrixXd>& system,
+                    const F_one& Pred1,
+                    const F_SS& PredSS,
+                    const std::vector<int>& auc_cmt,
+                    const std::vector<int>& segments,
+                    const std::vector<int>& first_keep,
+                    int thread, int nThreads,
+                    Eigen::MatrixXd& pred,
+                    std::exception_ptr& error)
+    : schedule_(schedule), pMatrix_(pMatrix), biovar_(biovar), nCmt_(nCmt),
+      system_(system), Pred1_(Pred1), PredSS_(PredSS), auc_cmt_(auc_cmt),
+      segments_(segments), first_keep_(first_keep), thread_(thread),
+      nThreads_(nThreads), pred_(pred), error_(error) { }
+
+  void operator()() {
+    using Eigen::Matrix;
+    using Eigen::Dynamic;
+    using std::vector;
+
+    try {
+      int nAuc = auc_cmt_.size(), nSegment = segments_.size();
+      Matrix<double, 1, Dynamic> init(nCmt_), auc(nAuc);
+      vector<double> rate2(nCmt_);
+      const vector<double> no_rates(nCmt_, 0);
+      ScheduleParameters<double, double>
+        parameters(schedule_, pMatrix_, biovar_, system_);
+
+      for (int s = thread_; s < nSegment; s += nThreads_) {
+        init.setZero();
+        auc.setZero();
+        int end = (s + 1 < nSegment) ? segments_[s + 1]
+          : schedule_.get_size(), ikeep = first_keep_[s];
+        for (EventSchedule::Cursor event(schedule_, segments_[s]);
+             event.get_index() < end; event.Next()) {
+          PredEvent(schedule_, event, parameters, nCmt_, Pred1_, PredSS_,
+                    auc_cmt_, no_rates, rate2, init, auc);
+          if (event.get_keep()) {
+            pred_.block(ikeep, 0, 1, nCmt_) = init;
+            if (nAuc > 0) pred_.block(ikeep, nCmt_, 1, nAuc) = auc;
+            ikeep++;
+          }
+        }
+      }
+    } catch (...) {
+      error_ = std::current_exception();
+    }
+  }
+};
+
+/**
+ * Sweeps over a compiled event schedule on several threads (see
+ * EventSchedule::set_threads). The segments of the schedule
+ * (see EventSchedule::get_segments), which start from amounts
+ * overwritten by a reset or a steady state event, do not depend on
+ * one another: they are computed concurrently from zero amounts,
+ * and their predictions are written at the rows of their kept
+ * events in the usual matrix. The predictions are identical to
+ * those of PredSweep.
+ *
+ * This requires the parameters to be data, since the autodiff
+ * stack of Stan is shared by the threads, and a model which
+ * supports it (see thread_safe_pred). Otherwise, or if the schedule
+ * has a single segment, the schedule is swept on the calling
+ * thread.
+ *
+ * @tparam T_parameters type of scalar for the ODE parameters
+ * @tparam T_biovar type of scalar for bio-variability parameters
+ * @param[in] schedule compiled event schedule
+ * @param[in] pMatrix parameters at each event
+ * @param[in] biovar bio-variability at each event
+ * @param[in] nCmt number of compartments in the model
+ * @param[in] system matrices describing linear ODE systems
+ * @param[in] auc_cmt compartments (starting at 1) whose AUC is
+ * returned after the amounts.
+ * @return a matrix with predicted amount in each compartment
+ * at each kept event.
+ */
+template<typename T_parameters,
+         typename T_biovar,
+         typename F_one,
+         typename F_SS>
+Eigen::Matrix<typename boost::math::tools::promote_args<T_parameters,
+  T_biovar>::type, Eigen::Dynamic, Eigen::Dynamic>
+PredConcurrent(const EventSchedule& schedule,
+               const std::vector<std::vector<T_parameters> >& pMatrix,
+               const std::vector<std::vector<T_biovar> >& biovar,
+               int nCmt,
+               const std::vector<Eigen::Matrix<T_parameters,
+                 Eigen::Dynamic, Eigen::Dynamic> >& system,
+               const F_one& Pred1,
+               const F_SS& PredSS,
+               const std::vector<int>& auc_cmt,
+               boost::false_type) {
+  return PredSweep(schedule, pMatrix, biovar, nCmt, system, Pred1, PredSS,
+                   0, auc_cmt);
+}
+
+template<typename F_one,
+         typename F_SS>
+Eigen::MatrixXd
+PredConcurrent(const EventSchedule& schedule,
+               const std::vector<std::vector<double> >& pMatrix,
+               const std::vector<std::vector<double> >& biovar,
+               int nCmt,
+               const std::vector<Eigen::MatrixXd>& system,
+               const F_one& Pred1,
+               const F_SS& PredSS,
+               const std::vector<int>& auc_cmt,
+               boost::true_type) {
+  using std::vector;
+
+  const vector<int>& segments = schedule.get_segments(!auc_cmt.empty());
+  int nSegment = segments.size();
+  int nThreads = schedule.get_threads();
+  if (nThreads == 0) nThreads = std::thread::hardware_concurrency();
+  nThreads = std::min(nThreads, nSegment);
+  if (nThreads <= 1)
+    return PredSweep(schedule, pMatrix, biovar, nCmt, system, Pred1, PredSS,
+                     0, auc_cmt);
+
+  // index of the first kept event of each segment.
+  vector<int> first_keep(nSegment, 0);
+  for (int s = 1; s < nSegment; s++) {
+    first_keep[s] = first_keep[s - 1];
+    for (EventSchedule::Cursor event(schedule, segments[s - 1]);
+         event.get_index() < segments[s]; event.Next())
+      if (event.get_keep()) first_keep[s]++;
+  }
+
+  Eigen::MatrixXd pred(schedule.get_nKeep(), nCmt + auc_cmt.size());
+  vector<std::exception_ptr> errors(nThreads);
+  vector<std::thread> threads;
+  threads.reserve(nThreads - 1);
+  for (int k = 1; k < nThreads; k++)
+    threads.push_back(std::thread(PredSegmentWorker<F_one, F_SS>
+      (schedule, pMatrix, biovar, nCmt, system, Pred1, PredSS, auc_cmt,
+       segments, first_keep, k, nThreads, pred, errors[k])));
+  PredSegmentWorker<F_one, F_SS>(schedule, pMatrix, biovar, nCmt, system,
+                                 Pred1, PredSS, auc_cmt, segments,
+                                 first_keep, 0, nThreads, pred, errors[0])();
+  for (size_t k = 0; k < threads.size(); k++) threads[k].join();
+
+  for (int k = 0; k < nThreads; k++)
+    if (errors[k]) std::rethrow_exception(errors[k]);
+  return pred;
+}
+
+template<typename T_parameters,
+         typename T_biovar,
+         typename F_one,
+         typename F_SS>
+Eigen::Matrix<typename boost::math::tools::promote_args<T_parameters,
+  T_biovar>::type, Eigen::Dynamic, Eigen::Dynamic>
+PredConcurrent(const EventSchedule& schedule,
+               const std::vector<std::vector<T_parameters> >& pMatrix,
+               const std::vector<std::vector<T_biovar> >& biovar,
+               int nCmt,
+               const std::vector<Eigen::Matrix<T_parameters,
+                 Eigen::Dynamic, Eigen::Dynamic> >& system,
+               const F_one& Pred1,
+               const F_SS& PredSS,
+               const std::vector<int>& auc_cmt) {
+  typedef typename boost::math::tools::promote_args<T_parameters,
+    T_biovar>::type scalar;
+  return PredConcurrent(schedule, pMatrix, biovar, nCmt, system, Pred1,
+                        PredSS, auc_cmt,
+                        boost::integral_constant<bool,
+                          boost::is_same<scalar, double>::value
+                          && thread_safe_pred<F_one>::value
+                          && thread_safe_pred<F_SS>::value>());
+}
+
+}
+
+#endif
@@ -0,0 +1,360 @@
+#ifndef STAN_MATH_TORSTEN_PKMODEL_PREDSCHEDULE_HPP
+#define STAN_MATH_TORSTEN_PKMODEL_PREDSCHEDULE_HPP
+
+#include <stan/math/torsten/PKModel/profile.hpp>
+#include <stan/math/torsten/PKModel/trace.hpp>
+#include <stan/math/torsten/PKModel/tape_footprint.hpp>
+#include <stan/math/torsten/PKModel/Pred/unpromote.hpp>
+#include <stan/math/torsten/PKModel/ModelParameters.hpp>
+#include <stan/math/torsten/PKModel/EventSchedule.hpp>
+#include <stan/math/torsten/PKModel/PredSink.hpp>
+#include <stan/math/torsten/PKModel/preserves_zero_state.hpp>
+#include <stan/math/prim/scal/err/invalid_argument.hpp>
+#include <Eigen/Dense>
+#include <vector>
+
+namespace torsten {
+
+/**
+ * Computes the amounts at the end of an interval of length dt and
+ * the integral over the interval of the amounts in the compartments
+ * cmts, for Pred with AUC outputs. Models which support AUC outputs
+ * overload this function next to their Pred1 functor; for the
+ * others, an exception is thrown.
+ */
+template<typename F_one, typename T_time, typename T_parameters,
+         typename T_biovar, typename T_tlag, typename T_init,
+         typename T_rate>
+void Pred1AUC(const F_one& Pred1,
+              const T_time& dt,
+              const ModelParameters<T_time, T_parameters, T_biovar,
+                                    T_tlag>& parameter,
+              const Eigen::Matrix<T_init, 1, Eigen::Dynamic>& init,
+              const std::vector<T_rate>& rate,
+              const std::vector<int>& cmts,
+              Eigen::Matrix<T_init, Eigen::Dynamic, 1>& pred,
+              Eigen::Matrix<T_init, 1, Eigen::Dynamic>& auc) {
+  stan::math::invalid_argument("Pred", "number of AUC compartments",
+                               cmts.size(), "",
+                               ", but AUC outputs are not available for "
+                               "this model!");
+}
+
+/**
+ * Checks the compartments (starting at 1) of the AUC outputs.
+ */
+inline void CheckAUCCompartments(const std::vector<int>& auc_cmt,
+                                 int nCmt) {
+  for (size_t i = 0; i < auc_cmt.size(); i++)
+    if (auc_cmt[i] < 1 || auc_cmt[i] > nCmt)
+      stan::math::invalid_argument("Pred", "AUC compartment", auc_cmt[i], "",
+                                   " is not a compartment of the model!");
+}
+
+/**
+ * Returns the rate in a compartment scaled by the bio-availability.
+ * A zero rate which is data stays zero, so that it does not become
+ * an autodiff variable when the bio-availability is a parameter.
+ */
+template<typename T_rate, typename T_biovar>
+inline typename boost::math::tools::promote_args<T_rate, T_biovar>::type
+BiovarRate(const T_rate& rate, const T_biovar& biovar) {
+  if (stan::is_constant_struct<T_rate>::value && rate == 0) return 0;
+  return rate * biovar;
+}
+
+/**
+ * Sets (ss = 1 or 3) or adds to (ss = 2) the amounts in init the
+ * amounts of a steady state event. The amounts are combined with
+ * init element by element, so that they are not promoted first to
+ * the scalar type of init when they depend on fewer parameters
+ * (for instance, they do not depend on the lag times).
+ */
+template<typename T_init, typename D>
+inline void SteadyState(Eigen::Matrix<T_init, 1, Eigen::Dynamic>& init,
+                        const Eigen::MatrixBase<D>& amounts, int ss) {
+  for (int j = 0; j < init.cols(); j++) {
+    if (ss == 2) init(0, j) += amounts(j);
+    else
+      init(0, j) = amounts(j);
+  }
+}
+
+/**
+ * Parameters of the events of a compiled schedule, read from the
+ * rows of the parameter arrays the schedule points to.
+ *
+ * The parameters of the current event are kept in one object,
+ * which is rebuilt only when the event points to rows whose
+ * contents differ from those of the previous event (see
+ * same_value): runs of events with the same parameters, such as
+ * a covariate updated every few weeks with one row per event,
+ * share it.
+ *
+ * @tparam T_parameters type of scalar for the ODE parameters
+ * @tparam T_biovar type of scalar for bio-variability parameters
+ */
+template<typename T_parameters, typename T_biovar>
+class ScheduleParameters {
+private:
+  const EventSchedule& schedule_;
+  const std::vector<std::vector<T_parameters> >& pMatrix_;
+  const std::vector<std::vector<T_biovar> >& biovar_;
+  const std::vector<Eigen::Matrix<T_parameters, Eigen::Dynamic,
+                                  Eigen::Dynamic> >& system_;
+  ModelParameters<double, T_parameters, T_biovar, double> parameter_;
+  int theta_row_, biovar_row_, system_row_;  // rows of parameter_
+  int nBuild_;
+
+public:
+  ScheduleParameters(const EventSchedule& schedule,
+                     const std::vector<std::vector<T_parameters> >& pMatrix,
+                     const std::vector<std::vector<T_biovar> >& biovar,
+                     const std::vector<Eigen::Matrix<T_parameters,
+                       Eigen::Dynamic, Eigen::Dynamic> >& system)
+    : schedule_(schedule), pMatrix_(pMatrix), biovar_(biovar),
+      system_(system), theta_row_(-1), biovar_row_(-1), system_row_(-1),
+      nBuild_(0) { }
+
+  /**
+   * Returns the parameters at the event of the cursor. The
+   * reference is valid until the next call.
+   */
+  const ModelParameters<double, T_parameters, T_biovar, double>&
+  Get(const EventSchedule::Cursor& event) {
+    int theta_row = event.get_theta_row(),
+      biovar_row = event.get_biovar_row(),
+      system_row = event.get_system_row();
+    if (theta_row != theta_row_ || biovar_row != biovar_row_
+        || system_row != system_row_) {
+      if (theta_row_ < 0
+          || !same_value(pMatrix_[theta_row], pMatrix_[theta_row_])
+          || !same_value(biovar_[biovar_row], biovar_[biovar_row_])
+          || !same_value(system_[system_row], system_[system_row_])) {
+        parameter_ = ModelParameters<double, T_parameters, T_biovar, double>
+          (event.get_time(), pMatrix_[theta_row], biovar_[biovar_row],
+           std::vector<double>(), system_[system_row]);
+        nBuild_++;
+      }
+      theta_row_ = theta_row;
+      biovar_row_ = biovar_row;
+      system_row_ = system_row;
+    }
+    parameter_.time(event.get_time());
+    return parameter_;
+  }
+
+  /**
+   * Returns the bio-availability at the event of the cursor.
+   */
+  const std::vector<T_biovar>&
+  get_biovar(const EventSchedule::Cursor& event) const {
+    return biovar_[event.get_biovar_row()];
+  }
+
+  /**
+   * Returns the number of parameter objects built so far, that is
+   * the number of runs of events with the same parameters.
+   */
+  int get_nBuild() const { return nBuild_; }
+};
+
+/**
+ * Advances the amounts (and the AUCs) of a compiled event schedule
+ * over the event of a cursor: the amounts are computed at the time of the
+ * event from the amounts at the previous event, then the steady
+ * state and bolus doses of the event are applied.
+ * Events before the first dose are skipped for the models which
+ * keep zero amounts at zero (see preserves_zero_state).
+ *
+ * This is the step of the sweep of Pred over a schedule, and is
+ * also used to recompute segments of the schedule (see
+ * PredCheckpoint).
+ *
+ * @tparam T_init type of scalar for the amounts
+ * @tparam T_parameters type of scalar for the ODE parameters
+ * @tparam T_biovar type of scalar for bio-variability parameters
+ * @param[in] schedule compiled event schedule
+ * @param[in] event cursor at the event
+ * @param[in, out] parameters parameters of the events
+ * @param[in] nCmt number of compartments in the model
+ * @param[in] auc_cmt compartments (starting at 1) of the AUCs
+ * @param[in] no_rates zero rate in each compartment, passed to Pred1
+ * when the schedule has no infusions
+ * @param[in, out] rate2 work vector of size nCmt for the rates
+ * @param[in, out] init amount in each compartment
+ * @param[in, out] auc AUC in each compartment of auc_cmt
+ */
+template<typename T_init,
+         typename T_parameters,
+         typename T_biovar,
+         typename F_one,
+         typename F_SS>
+void PredEvent(const EventSchedule& schedule,
+               const EventSchedule::Cursor& event,
+               ScheduleParameters<T_parameters, T_biovar>& parameters,
+               int nCmt,
+               const F_one& Pred1,
+               const F_SS& PredSS,
+               const std::vector<int>& auc_cmt,
+               const std::vector<double>& no_rates,
+               std::vector<T_biovar>& rate2,
+               Eigen::Matrix<T_init, 1, Eigen::Dynamic>& init,
+               Eigen::Matrix<T_init, 1, Eigen::Dynamic>& auc) {
+  using Eigen::Matrix;
+  using Eigen::Dynamic;
+  using std::vector;
+
+  // the amounts stay at zero up to the first dose, if the model
+  // keeps them there.
+  if (preserves_zero_state<F_one>::value
+      && event.get_index() < schedule.get_first_dose())
+    return;
+
+  int evid = event.get_evid(), ss = event.get_ss(), cmt = event.get_cmt();
+  bool infusions = schedule.HasInfusions();
+  TORSTEN_TRACE_SPAN(event_span, "event");
+  TORSTEN_TRACE_ARG(event_span, "index", event.get_index());
+  TORSTEN_TRACE_ARG(event_span, "time", event.get_time());
+  TORSTEN_TRACE_ARG(event_span, "evid", evid);
+
+  const vector<T_biovar>& biovar_i = parameters.get_biovar(event);
+  if (infusions)
+    for (int j = 0; j < nCmt; j++)
+      rate2[j] = BiovarRate(event.get_cmt_rate(j), biovar_i[j]);
+
+  const ModelParameters<double, T_parameters, T_biovar, double>&
+    parameter = parameters.Get(event);
+
+  if ((evid == 3) || (evid == 4)) {  // reset events
+    init.setZero();
+    auc.setZero();
+  } else {
+    TORSTEN_PROFILE_SCOPE("Pred::Pred1");
+    TORSTEN_TAPE_SCOPE("Pred::Pred1");
+    double dt = event.get_interval();
+    TORSTEN_TRACE_SPAN(pred1_span, "Pred1");
+    TORSTEN_TRACE_ARG(pred1_span, "functor", FunctorName<F_one>());
+    TORSTEN_TRACE_ARG(pred1_span, "dt", dt);
+    Matrix<T_init, Dynamic, 1> pred1;
+    if (auc_cmt.empty()) {
+      if (infusions)
+        pred1 = Pred1(dt, parameter, init, rate2);
+      else
+        pred1 = Pred1(dt, parameter, init, no_rates);
+    } else {
+      Matrix<T_init, 1, Dynamic> auc1;
+      if (infusions)
+        Pred1AUC(Pred1, dt, parameter, init, rate2, auc_cmt, pred1, auc1);
+      else
+        Pred1AUC(Pred1, dt, parameter, init, no_rates, auc_cmt, pred1,
+                 auc1);
+      auc += auc1;
+    }
+    init = pred1;
+  }
+
+  if (((evid == 1 || evid == 4) && (ss == 1 || ss == 2)) ||
+    ss == 3) {  // steady state event
+    TORSTEN_PROFILE_SCOPE("Pred::PredSS");
+    TORSTEN_TAPE_SCOPE("Pred::PredSS");
+    TORSTEN_TRACE_SPAN(predSS_span, "PredSS");
+    TORSTEN_TRACE_ARG(predSS_span, "functor", FunctorName<F_SS>());
+    TORSTEN_TRACE_ARG(predSS_span, "ss", ss);
+    TORSTEN_TRACE_ARG(predSS_span, "ii", event.get_ii());
+    SteadyState(init, PredSS(parameter, biovar_i[cmt - 1] * event.get_amt(),
+                             event.get_rate(), event.get_ii(), cmt),
+                ss);
+  }
+
+  if (((evid == 1) || (evid == 4)) &&
+    (event.get_rate() == 0)) {  // bolus dose
+    init(0, cmt - 1) += biovar_i[cmt - 1] * event.get_amt();
+  }
+}
+
+/**
+ * Sweeps over a compiled event schedule and returns the amounts
+ * (and AUCs) at the kept events, or passes them to a sink. This is
+ * the body of the overload of Pred for an EventSchedule.
+ *
+ * @tparam T_parameters type of scalar for the ODE parameters
+ * @tparam T_biovar type of scalar for bio-variability parameters
+ * @param[in] schedule compiled event schedule
+ * @param[in] pMatrix parameters at each event
+ * @param[in] biovar bio-variability at each event
+ * @param[in] nCmt number of compartments in the model
+ * @param[in] system matrices describing linear ODE systems
+ * @param[in] sink if not null, receives the predicted amounts at
+ * each kept event, which are then not stored in the returned matrix.
+ * @param[in] auc_cmt compartments (starting at 1) whose AUC is
+ * returned after the amounts.
+ * @return a matrix with predicted amount in each compartment
+ * at each kept event, or an empty matrix if sink is not null.
+ */
+template<typename T_parameters,
+         typename T_biovar,
+         typename F_one,
+         typename F_SS>
+Eigen::Matrix<typename boost::math::tools::promote_args<T_parameters,
+  T_biovar>::type, Eigen::Dynamic, Eigen::Dynamic>
+PredSweep(const EventSchedule& schedule,
+          const std::vector<std::vector<T_parameters> >& pMatrix,
+          const std::vector<std::vector<T_biovar> >& biovar,
+          int nCmt,
+          const std::vector<Eigen::Matrix<T_parameters,
+            Eigen::Dynamic, Eigen::Dynamic> >& system,
+          const F_one& Pred1,
+          const F_SS& PredSS,
+          PredSink* sink,
+          const std::vector<int>& auc_cmt) {
+  using Eigen::Matrix;
+  using Eigen::Dynamic;
+  using boost::math::tools::promote_args;
+  using std::vector;
+
+  typedef typename promote_args<T_parameters, T_biovar>::type scalar;
+
+  int nAuc = auc_cmt.size();
+  Matrix<scalar, 1, Dynamic> init = Matrix<scalar, 1, Dynamic>::Zero(nCmt);
+  Matrix<scalar, 1, Dynamic> auc = Matrix<scalar, 1, Dynamic>::Zero(nAuc);
+
+  // COMPUTE PREDICTIONS
+  Matrix<scalar, Dynamic, Dynamic>
+    pred = Matrix<scalar, Dynamic, Dynamic>::Zero(sink ? 0
+                                                  : schedule.get_nKeep(),
+                                                  nCmt + nAuc);
+  vector<double> amounts(sink ? nCmt + nAuc : 0);
+  if (sink) sink->SetLayout(nCmt, auc_cmt);
+  vector<T_biovar> rate2(nCmt);
+  const vector<double> no_rates(nCmt, 0);
+  ScheduleParameters<T_parameters, T_biovar>
+    parameters(schedule, pMatrix, biovar, system);
+  int ikeep = 0;
+
+  for (EventSchedule::Cursor event(schedule, 0); !event.done();
+       event.Next()) {
+    PredEvent(schedule, event, parameters, nCmt, Pred1, PredSS, auc_cmt,
+              no_rates, rate2, init, auc);
+
+    if (event.get_keep()) {
+      TORSTEN_PROFILE_SCOPE("Pred::output");
+      TORSTEN_TAPE_SCOPE("Pred::output");
+      if (sink) {
+        for (int j = 0; j < nCmt; j++) amounts[j] = unpromote(init(0, j));
+        for (int j = 0; j < nAuc; j++) amounts[nCmt + j] = unpromote(auc(j));
+        sink->Write(schedule.get_id(), event.get_time(), amounts);
+      } else {
+        pred.block(ikeep, 0, 1, nCmt) = init;
+        if (nAuc > 0) pred.block(ikeep, nCmt, 1, nAuc) = auc;
+      }
+      ikeep++;
+    }
+  }
+
+  return pred;
+}
+
+}
+
+#endif
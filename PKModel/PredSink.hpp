@@ -0,0 +1,51 @@
+#ifndef STAN_MATH_TORSTEN_PKMODEL_PREDSINK_HPP
+#define STAN_MATH_TORSTEN_PKMODEL_PREDSINK_HPP
+
+#include <vector>
+
+namespace torsten {
+
+/**
+ * Receiver of the predictions computed by Pred, one kept event
+ * at a time. When a sink is passed to a model function, the
+ * predicted amounts are handed to the sink as they are computed
+ * instead of being stored in the returned matrix, so that the
+ * memory used by a simulation does not grow with the number of
+ * subjects or events.
+ *
+ * Amounts are passed as doubles: when the parameters are
+ * autodiff variables, the sink receives their values.
+ *
+ * See io/pred_writer.hpp for a buffered writer to a CSV or binary
+ * file.
+ */
+class PredSink {
+public:
+  virtual ~PredSink() { }
+
+  /**
+   * Receives the layout of the amounts passed to Write, before the
+   * first prediction of each call to Pred: the amounts in the nCmt
+   * compartments of the model, followed by the AUCs of the
+   * compartments auc_cmt (starting at 1), if any.
+   *
+   * @param[in] nCmt number of compartments of the model
+   * @param[in] auc_cmt compartments of the AUCs
+   */
+  virtual void SetLayout(int nCmt, const std::vector<int>& auc_cmt) { }
+
+  /**
+   * Receives the predicted amounts at a kept event.
+   *
+   * @param[in] id ID of the subject (see EventSchedule::set_id)
+   * @param[in] time time of the event
+   * @param[in] amounts amount in each compartment of the model,
+   * followed by the AUCs (see SetLayout)
+   */
+  virtual void Write(double id, double time,
+                     const std::vector<double>& amounts) = 0;
+};
+
+}  // torsten namespace
+
+#endif
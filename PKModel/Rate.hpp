@@ -3,6 +3,7 @@
 
 #include <Eigen/Dense>
 #include <stan/math/torsten/PKModel/functions.hpp>
+#include <stan/math/torsten/PKModel/arena.hpp>
 #include <algorithm>
 #include <vector>
 
@@ -18,25 +19,27 @@ template<typename T_time, typename T_rate> class RateHistory;
  */
 template<typename T_time, typename T_rate>
 class Rate {
+public:
+  typedef std::vector<T_rate, arena_allocator<T_rate> > rate_vector;
+
 private:
   T_time time;
-  std::vector<T_rate> rate;  // rate for each compartment
+  rate_vector rate;  // rate for each compartment
 
 public:
   Rate() {
-    std::vector<T_rate> v(1, 0);
     time = 0;
-    rate = v;
+    rate.assign(1, 0);
   }
 
-  Rate(T_time p_time, std::vector<T_rate> p_rate) {
+  Rate(T_time p_time, const std::vector<T_rate>& p_rate) {
     time = p_time;
-    rate = p_rate;
+    rate.assign(p_rate.begin(), p_rate.end());
   }
 
   // access functions
   T_time get_time() const { return time; }
-  std::vector<T_rate> get_rate() const { return rate; }
+  const rate_vector& get_rate() const { return rate; }
 
   // Overload = operator
   // Allows us to construct a rate of var from a rate of double
@@ -58,29 +61,6 @@ public:
   template <typename T_amt, typename T_ii>
   friend void MakeRates(torsten::EventHistory<T_time, T_amt, T_rate, T_ii>&,
     RateHistory<T_time, T_rate>&);
-
-  template <typename T_0, typename T_1, typename T_2, typename T_3,
-    typename T_4, typename T_5, typename T_6, typename F_1, typename F_2>
-  friend
-  Eigen::Matrix<typename boost::math::tools::promote_args<T_0, T_1, T_2, T_3,
-    typename boost::math::tools::promote_args<T_4, T_5, T_6>::type
-    >::type, Eigen::Dynamic, Eigen::Dynamic>
-  Pred(const std::vector<T_0>& time,
-       const std::vector<T_1>& amt,
-       const std::vector<T_2>& rate,
-       const std::vector<T_3>& ii,
-       const std::vector<int>& evid,
-       const std::vector<int>& cmt,
-       const std::vector<int>& addl,
-       const std::vector<int>& ss,
-       const std::vector<std::vector<T_4> >& pMatrix,
-       const std::vector<std::vector<T_5> >& biovar,
-       const std::vector<std::vector<T_6> >& tlag,
-       const int& nCmt,
-       const std::vector<Eigen::Matrix<T_4, Eigen::Dynamic, Eigen::Dynamic> >&
-         system,
-       const F_1& f1,
-       const F_2& fss);
 };
 
 /**
@@ -90,7 +70,8 @@ public:
 template <typename T_time, typename T_rate>
 class RateHistory {
 private:
-  std::vector<Rate<T_time, T_rate> > Rates;
+  typedef Rate<T_time, T_rate> rate_type;
+  std::vector<rate_type, arena_allocator<rate_type> > Rates;
 
 public:
   RateHistory() {
@@ -114,7 +95,9 @@ public:
   }
 
   T_time get_time(int i) { return Rates[i].time; }
-  std::vector<T_rate> get_rate(int i) { return Rates[i].rate; }
+  const typename rate_type::rate_vector& get_rate(int i) const {
+    return Rates[i].rate;
+  }
 
   bool Check() {
     int i = Rates.size() - 1;
@@ -127,11 +110,6 @@ public:
     return ordered;
   }
 
-  Rate<T_time, T_rate> GetRate(int i) {
-    Rate<T_time, T_rate> newRate(Rates[i].time, Rates[i].rate);
-    return newRate;
-  }
-
   void InsertRate(Rate<T_time, T_rate> p_Rate) { Rates.push_back(p_Rate); }
 
   void RemoveRate(int i) {
@@ -141,6 +119,17 @@ public:
 
   int Size() { return Rates.size(); }
 
+  /**
+   * Returns true if the rate in some compartment is not zero at
+   * some time.
+   */
+  bool HasInfusions() {
+    for (size_t i = 0; i < Rates.size(); i++)
+      for (size_t j = 0; j < Rates[i].rate.size(); j++)
+        if (Rates[i].rate[j] != 0) return true;
+    return false;
+  }
+
   void Print(int j) {
     std::cout << Rates[j].time << " ";
     for (int i = 0; i < Rates[j].rate.size(); i++)
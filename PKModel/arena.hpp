@@ -0,0 +1,196 @@
+#ifndef STAN_MATH_TORSTEN_PKMODEL_ARENA_HPP
+#define STAN_MATH_TORSTEN_PKMODEL_ARENA_HPP
+
+#include <cstddef>
+#include <limits>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace torsten {
+
+/**
+ * Monotonic arena for the book-keeping objects of Pred (events,
+ * rates and parameter histories).
+ *
+ * Memory is carved out of large blocks and never freed
+ * individually: when the outermost PredArenaScope of the thread
+ * ends, the arena is rewound in one shot, and its blocks are kept
+ * for the next call. Each thread has its own arena (see
+ * GetPredArena()), so that concurrent calls do not contend for the
+ * general heap.
+ */
+class PredArena {
+private:
+  std::vector<char*> blocks_;
+  std::vector<size_t> sizes_;
+  size_t block_;  // index of the current block
+  size_t used_;   // bytes used in the current block
+  int depth_;     // number of open scopes
+
+  static const size_t min_block_size = 64 * 1024;
+  static const size_t alignment = sizeof(long double);  // NOLINT
+
+  PredArena(const PredArena&);
+  PredArena& operator=(const PredArena&);
+
+public:
+  PredArena() : block_(0), used_(0), depth_(0) { }
+
+  ~PredArena() { Free(); }
+
+  /**
+   * Returns bytes of memory from the current block, moving to the
+   * next block (or allocating a new one) if it is too small.
+   */
+  void* Allocate(size_t bytes) {
+    bytes = (bytes + alignment - 1) / alignment * alignment;
+    while (block_ < blocks_.size() && used_ + bytes > sizes_[block_]) {
+      block_++;
+      used_ = 0;
+    }
+    if (block_ == blocks_.size()) {
+      size_t size = min_block_size;
+      if (!blocks_.empty()) size = 2 * sizes_.back();
+      if (size < bytes) size = bytes;
+      blocks_.push_back(static_cast<char*>(::operator new(size)));
+      sizes_.push_back(size);
+      used_ = 0;
+    }
+    void* p = blocks_[block_] + used_;
+    used_ += bytes;
+    return p;
+  }
+
+  /**
+   * Rewinds the arena. The memory handed out so far must no longer
+   * be in use.
+   */
+  void Release() {
+    block_ = 0;
+    used_ = 0;
+  }
+
+  /**
+   * Returns the blocks of the arena to the heap (for instance after
+   * an unusually large call). Does nothing while a scope is open.
+   */
+  void Free() {
+    if (depth_ > 0) return;
+    for (size_t i = 0; i < blocks_.size(); i++) ::operator delete(blocks_[i]);
+    blocks_.clear();
+    sizes_.clear();
+    Release();
+  }
+
+  void Enter() { depth_++; }
+
+  void Leave() {
+    if (--depth_ == 0) Release();
+  }
+
+  bool active() const { return depth_ > 0; }
+
+  /**
+   * Returns the number of bytes reserved by the arena.
+   */
+  size_t capacity() const {
+    size_t total = 0;
+    for (size_t i = 0; i < sizes_.size(); i++) total += sizes_[i];
+    return total;
+  }
+};
+
+/**
+ * Returns the arena of the calling thread.
+ */
+inline PredArena& GetPredArena() {
+  static thread_local PredArena arena;
+  return arena;
+}
+
+/**
+ * Opens the arena of the calling thread for the lifetime of the
+ * object. Scopes nest: the arena is rewound when the outermost one
+ * ends, so that objects using arena_allocator must be destroyed
+ * before (i.e. declared after) the scope.
+ */
+class PredArenaScope {
+private:
+  PredArenaScope(const PredArenaScope&);
+  PredArenaScope& operator=(const PredArenaScope&);
+
+public:
+  PredArenaScope() { GetPredArena().Enter(); }
+  ~PredArenaScope() { GetPredArena().Leave(); }
+};
+
+/**
+ * Standard allocator drawing from the arena of the calling thread
+ * when it is constructed inside a PredArenaScope. Deallocation is
+ * then a no-op, the memory being reclaimed with the arena.
+ * Outside of a scope, the allocator falls back on the heap, so that
+ * the book-keeping classes stay usable on their own.
+ */
+template <typename T>
+class arena_allocator {
+public:
+  typedef T value_type;
+  typedef T* pointer;
+  typedef const T* const_pointer;
+  typedef T& reference;
+  typedef const T& const_reference;
+  typedef size_t size_type;
+  typedef std::ptrdiff_t difference_type;
+
+  template <typename U>
+  struct rebind { typedef arena_allocator<U> other; };
+
+  PredArena* arena_;
+
+  arena_allocator()
+    : arena_(GetPredArena().active() ? &GetPredArena() : 0) { }
+
+  template <typename U>
+  arena_allocator(const arena_allocator<U>& other)  // NOLINT
+    : arena_(other.arena_) { }
+
+  T* allocate(size_t n) {
+    if (n > std::numeric_limits<size_t>::max() / sizeof(T))
+      throw std::bad_alloc();
+    if (arena_) return static_cast<T*>(arena_->Allocate(n * sizeof(T)));
+    return static_cast<T*>(::operator new(n * sizeof(T)));
+  }
+
+  void deallocate(T* p, size_t) {
+    if (!arena_) ::operator delete(p);
+  }
+
+  size_t max_size() const {
+    return std::numeric_limits<size_t>::max() / sizeof(T);
+  }
+
+  template <typename U, typename... Args>
+  void construct(U* p, Args&&... args) {
+    ::new(static_cast<void*>(p)) U(std::forward<Args>(args)...);
+  }
+
+  template <typename U>
+  void destroy(U* p) { p->~U(); }
+};
+
+template <typename T, typename U>
+inline bool operator==(const arena_allocator<T>& a,
+                       const arena_allocator<U>& b) {
+  return a.arena_ == b.arena_;
+}
+
+template <typename T, typename U>
+inline bool operator!=(const arena_allocator<T>& a,
+                       const arena_allocator<U>& b) {
+  return a.arena_ != b.arena_;
+}
+
+}
+
+#endif
@@ -70,6 +70,8 @@ struct SS_system_dd {
     typedef typename boost::math::tools::promote_args<T0, T1>::type scalar;
     typedef typename stan::return_type<T0, T1>::type T_deriv;
 
+    TORSTEN_PROFILE_SCOPE("SS_system");
+
     double t0 = 0;
     vector<double> ts(1);
 
@@ -199,6 +201,8 @@ struct SS_system_vd {
     typedef typename boost::math::tools::promote_args<T0, T1>::type scalar;
     typedef typename stan::return_type<T0, T1>::type T_deriv;
 
+    TORSTEN_PROFILE_SCOPE("SS_system");
+
     double t0 = 0;
     vector<double> ts(1);
     vector<double> rate_v(dat.size(), 0);
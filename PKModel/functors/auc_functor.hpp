@@ -0,0 +1,79 @@
+#ifndef STAN_MATH_TORSTEN_PKMODEL_FUNCTORS_AUC_FUNCTOR_HPP
+#define STAN_MATH_TORSTEN_PKMODEL_FUNCTORS_AUC_FUNCTOR_HPP
+
+#include <stan/math/rev/core.hpp>
+#include <stan/math/fwd/core.hpp>
+#include <vector>
+#include <iostream>
+
+namespace torsten {
+
+/**
+ * Appends one quadrature state per AUC compartment to the ODE
+ * system of a general functor: the derivative of the state is the
+ * amount in the compartment, so that the state holds the integral
+ * of the amount over the integration interval.
+ *
+ * The first nCmt states are passed to the original functor. The
+ * rates of the quadrature states (last elements of x_r or theta)
+ * are zero and are dropped.
+ */
+template <typename F0>
+struct auc_functor {
+  F0 f0_;
+  int nCmt_;
+  std::vector<int> cmts_;
+
+  auc_functor() { }
+
+  auc_functor(const F0& f0, int nCmt, const std::vector<int>& cmts)
+    : f0_(f0), nCmt_(nCmt), cmts_(cmts) { }
+
+  template <typename T0, typename T1, typename T2, typename T3>
+  inline
+  std::vector<typename boost::math::tools::promote_args<T0, T1, T2, T3>::type>
+  rate_dbl(const T0& t,
+           const std::vector<T1>& y,
+           const std::vector<T2>& theta,
+           const std::vector<T3>& x_r,
+           const std::vector<int>& x_i,
+           std::ostream* pstream_) const {
+    typedef typename boost::math::tools::promote_args<T0, T1, T2, T3>::type
+      scalar;
+
+    std::vector<T1> y_cmt(y.begin(), y.begin() + nCmt_);
+    std::vector<T3> x_r_cmt(x_r.begin(), x_r.end() - cmts_.size());
+    std::vector<scalar> dydt = f0_.rate_dbl(t, y_cmt, theta, x_r_cmt, x_i,
+                                            pstream_);
+    for (size_t i = 0; i < cmts_.size(); i++)
+      dydt.push_back(y[cmts_[i] - 1]);
+
+    return dydt;
+  }
+
+  template <typename T0, typename T1, typename T2, typename T3>
+  inline
+  std::vector<typename boost::math::tools::promote_args<T0, T1, T2, T3>::type>
+  rate_var(const T0& t,
+           const std::vector<T1>& y,
+           const std::vector<T2>& theta,
+           const std::vector<T3>& x_r,
+           const std::vector<int>& x_i,
+           std::ostream* pstream_) const {
+    typedef typename boost::math::tools::promote_args<T0, T1, T2, T3>::type
+      scalar;
+
+    std::vector<T1> y_cmt(y.begin(), y.begin() + nCmt_);
+    std::vector<T2> theta_cmt(theta.begin(), theta.end() - cmts_.size());
+    std::vector<scalar> dydt = f0_.rate_var(t, y_cmt, theta_cmt, x_r, x_i,
+                                            pstream_);
+    for (size_t i = 0; i < cmts_.size(); i++)
+      dydt.push_back(y[cmts_[i] - 1]);
+
+    return dydt;
+  }
+};
+
+}
+
+#endif
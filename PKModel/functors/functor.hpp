@@ -1,6 +1,8 @@
 #ifndef STAN_MATH_TORSTEN_PKMODEL_FUNCTORS_FUNCTOR_HPP
 #define STAN_MATH_TORSTEN_PKMODEL_FUNCTORS_FUNCTOR_HPP
 
+#include <stan/math/torsten/PKModel/trace.hpp>
+#include <stan/math/torsten/PKModel/work_budget.hpp>
 #include <stan/math/rev/core.hpp>
 #include <stan/math/fwd/core.hpp>
 #include <vector>
@@ -42,6 +44,50 @@ struct normalized_integrand_functor {
   }
 };
 
+/**
+ * Same as normalized_integrand_functor, when only the entries of
+ * (theta, t0, t1) which are autodiff variables are parameters of
+ * the ODE, the others being stored in the functor. layout[i] >= 0
+ * is the index of the i-th entry in the parameters; otherwise the
+ * entry is data[-layout[i] - 1].
+ */
+template <typename F0>
+struct partial_integrand_functor {
+  const F0& f0_;
+  const std::vector<int>& layout_;
+  const std::vector<double>& data_;
+
+  partial_integrand_functor(const F0& f0, const std::vector<int>& layout,
+                            const std::vector<double>& data) :
+    f0_(f0), layout_(layout), data_(data)
+  {}
+
+  template <typename T0, typename T1, typename T2>
+  inline
+  std::vector<typename boost::math::tools::promote_args<
+                T0, T1, T2>::type >
+  operator()(const T0& t,
+             const std::vector<T1>& y,
+             const std::vector<T2>& parameters,
+             const std::vector<double>& x_r,
+             const std::vector<int>& x_i,
+             std::ostream* pstream_) const {
+    std::vector<T2> theta(layout_.size());
+    for (size_t i = 0; i < layout_.size(); i++)
+      theta[i] = layout_[i] >= 0 ? parameters[layout_[i]]
+        : T2(data_[-layout_[i] - 1]);
+    const T2& t1_{theta.rbegin()[0]};
+    const T2& t0_{theta.rbegin()[1]};
+    const T2& jacobian {t1_ - t0_};
+    using scalar = typename boost::math::tools::promote_args<
+      T0, T1, T2>::type;
+    std::vector<scalar> res{jacobian *
+        f0_(t1_*t + t0_*(1.0-t), theta, x_r, x_i, pstream_)};
+
+    return res;
+  }
+};
+
 namespace torsten {
 
 /**
@@ -81,7 +127,11 @@ struct ode_rate_dbl_functor {
              const std::vector<T3>& x_r,
              const std::vector<int>& x_i,
              std::ostream* pstream_) const {
-     return f0_.rate_dbl(t, y, theta, x_r, x_i, pstream_);
+     TORSTEN_TRACE_COUNT_RHS();
+     std::vector<typename boost::math::tools::promote_args<T0, T1, T2,
+       T3>::type> dydt = f0_.rate_dbl(t, y, theta, x_r, x_i, pstream_);
+     GetWorkBudget().Charge(y, dydt);
+     return dydt;
   }
 };
 
@@ -104,7 +154,11 @@ struct ode_rate_var_functor {
               const std::vector<T3>& x_r,
               const std::vector<int>& x_i,
               std::ostream* pstream_) const {
-      return f0_.rate_var(t, y, theta, x_r, x_i, pstream_);
+      TORSTEN_TRACE_COUNT_RHS();
+      std::vector<typename boost::math::tools::promote_args<T0, T1, T2,
+        T3>::type> dydt = f0_.rate_var(t, y, theta, x_r, x_i, pstream_);
+      GetWorkBudget().Charge(y, dydt);
+      return dydt;
   }
 };
 
@@ -0,0 +1,197 @@
+#ifndef STAN_MATH_TORSTEN_PKMODEL_GAUSS_KRONROD_HPP
+#define STAN_MATH_TORSTEN_PKMODEL_GAUSS_KRONROD_HPP
+
+#include <stan/math/prim/scal/err/domain_error.hpp>
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <vector>
+
+namespace torsten {
+
+/**
+ * Nodes and weights of the 15 point Kronrod rule and of the
+ * embedded 7 point Gauss rule on (-1, 1), from QUADPACK (qk15).
+ * Only the non-negative nodes are stored, the rules being
+ * symmetric; the Gauss nodes are the odd Kronrod nodes.
+ */
+struct GaussKronrod15 {
+  static const double* nodes() {
+    static const double x[8] = {
+      0.991455371120812639206854697526329,
+      0.949107912342758524526189684047851,
+      0.864864423359769072789712788640926,
+      0.741531185599394439863864773280788,
+      0.586087235467691130294144845693013,
+      0.405845151377397166906606412076961,
+      0.207784955007898467600689403773245,
+      0.000000000000000000000000000000000};
+    return x;
+  }
+
+  static const double* kronrod_weights() {
+    static const double w[8] = {
+      0.022935322010529224963732008058970,
+      0.063092092629978553290700663189204,
+      0.104790010322250183839876322541518,
+      0.140653259715525918745189590510238,
+      0.169004726639267902826583426598550,
+      0.190350578064785409913256402421014,
+      0.204432940075298892414161999234649,
+      0.209482141084727828012999174891714};
+    return w;
+  }
+
+  static const double* gauss_weights() {
+    static const double w[4] = {
+      0.129484966168869693270611432679082,
+      0.279705391489276667901467771423780,
+      0.381830050505118944950369775488975,
+      0.417959183673469387755102040816327};
+    return w;
+  }
+};
+
+/**
+ * Integral and error estimate of a vector valued function over
+ * one interval, as used by gauss_kronrod_integrate.
+ */
+struct GaussKronrodInterval {
+  double a, b, priority;
+  std::vector<double> integral, error;
+
+  bool operator<(const GaussKronrodInterval& other) const {
+    return priority < other.priority;
+  }
+};
+
+/**
+ * Applies the Gauss-Kronrod 7-15 rule to g over (a, b). The
+ * error of each component is estimated by the difference between
+ * the two rules.
+ */
+template <typename G>
+inline void gauss_kronrod_rule(const G& g, int n, double a, double b,
+                               GaussKronrodInterval& interval,
+                               std::vector<double>& work) {
+  const double* x = GaussKronrod15::nodes();
+  const double* wk = GaussKronrod15::kronrod_weights();
+  const double* wg = GaussKronrod15::gauss_weights();
+  double center = 0.5 * (a + b), half = 0.5 * (b - a);
+
+  interval.a = a;
+  interval.b = b;
+  std::vector<double> gauss(n, 0);
+  interval.integral.assign(n, 0);
+  interval.error.assign(n, 0);
+
+  g(center, work);
+  for (int k = 0; k < n; k++) {
+    interval.integral[k] = wk[7] * work[k];
+    gauss[k] = wg[3] * work[k];
+  }
+  for (int j = 0; j < 7; j++) {
+    for (int side = -1; side <= 1; side += 2) {
+      g(center + side * half * x[j], work);
+      for (int k = 0; k < n; k++) {
+        interval.integral[k] += wk[j] * work[k];
+        if (j % 2 == 1) gauss[k] += wg[j / 2] * work[k];
+      }
+    }
+  }
+  for (int k = 0; k < n; k++) {
+    interval.integral[k] *= half;
+    interval.error[k] = std::fabs(interval.integral[k] - half * gauss[k]);
+  }
+}
+
+/**
+ * Adaptive Gauss-Kronrod quadrature of a vector valued function.
+ *
+ * The interval with the largest error estimate, relative to the
+ * requested tolerance, is bisected until the estimated error of
+ * every component k of the integral I is below
+ * max(abs_tol, rel_tol * |I_k|).
+ *
+ * @tparam G type of the integrand, called as g(t, values), where
+ *           values is a std::vector<double> of size n to fill
+ * @param[in] g integrand
+ * @param[in] n number of components of the integrand
+ * @param[in] a lower limit
+ * @param[in] b upper limit
+ * @param[in] rel_tol relative tolerance
+ * @param[in] abs_tol absolute tolerance
+ * @param[in] max_num_intervals maximal number of subintervals
+ * @param[out] integral integral of each component
+ * @throw std::domain_error if the tolerance is not met with
+ *        max_num_intervals subintervals, or if an integral is not
+ *        finite
+ */
+template <typename G>
+inline void gauss_kronrod_integrate(const G& g, int n, double a, double b,
+                                    double rel_tol, double abs_tol,
+                                    int max_num_intervals,
+                                    std::vector<double>& integral) {
+  std::vector<double> work(n), error(n);
+  integral.assign(n, 0);
+  if (a == b) return;
+
+  std::priority_queue<GaussKronrodInterval> intervals;
+  GaussKronrodInterval interval;
+  gauss_kronrod_rule(g, n, a, b, interval, work);
+  interval.priority = 0;
+  intervals.push(interval);
+  integral = interval.integral;
+  error = interval.error;
+
+  for (int num_intervals = 1; ; num_intervals++) {
+    bool converged = true;
+    for (int k = 0; k < n; k++) {
+      // a NaN integrand would otherwise pass the test below.
+      if (!std::isfinite(integral[k]))
+        stan::math::domain_error("gauss_kronrod_integrate", "integral",
+                                 integral[k], "is ", ", but must be "
+                                 "finite!");
+      if (!(error[k] <= std::max(abs_tol, rel_tol * std::fabs(integral[k]))))
+        converged = false;
+    }
+    if (converged) return;
+    if (num_intervals >= max_num_intervals)
+      stan::math::domain_error("gauss_kronrod_integrate",
+                               "number of subintervals", max_num_intervals,
+                               "", " was reached before the requested "
+                               "tolerance!");
+
+    // the priority of an interval is its largest error relative to
+    // the tolerance of the integral at the time it is created.
+    interval = intervals.top();
+    intervals.pop();
+    for (int k = 0; k < n; k++) {
+      integral[k] -= interval.integral[k];
+      error[k] -= interval.error[k];
+    }
+    double mid = 0.5 * (interval.a + interval.b);
+    GaussKronrodInterval halves[2];
+    gauss_kronrod_rule(g, n, interval.a, mid, halves[0], work);
+    gauss_kronrod_rule(g, n, mid, interval.b, halves[1], work);
+    for (int h = 0; h < 2; h++)
+      for (int k = 0; k < n; k++) {
+        integral[k] += halves[h].integral[k];
+        error[k] += halves[h].error[k];
+      }
+    for (int h = 0; h < 2; h++) {
+      halves[h].priority = 0;
+      for (int k = 0; k < n; k++) {
+        double tol = std::max(abs_tol, rel_tol * std::fabs(integral[k]));
+        halves[h].priority = std::max(halves[h].priority, tol > 0 ?
+                                      halves[h].error[k] / tol
+                                      : halves[h].error[k]);
+      }
+      intervals.push(halves[h]);
+    }
+  }
+}
+
+}  // torsten namespace
+
+#endif
@@ -2,6 +2,7 @@
 #define STAN_MATH_PMETRICS_PKMODEL_INTEGRATOR_HPP
 
 #include <Eigen/Dense>
+#include <stan/math/torsten/PKModel/profile.hpp>
 #include <stan/math/prim/arr/functor/integrate_ode_rk45.hpp>
 #include <stan/math/rev/mat/functor/integrate_ode_bdf.hpp>
 #include <iostream>
@@ -53,14 +54,17 @@ public:
               const std::vector<T2>& theta,
               const std::vector<double>& x,
               const std::vector<int>& x_int) const {
-    if (solver_type == "bdf")
+    if (solver_type == "bdf") {
+      TORSTEN_PROFILE_SCOPE("integrator::bdf");
       return stan::math::integrate_ode_bdf(f, y0, t0, ts, theta, x, x_int,
                                            msgs,
                                            rel_tol, abs_tol, max_num_steps);
-    else  // if(solver_type == "rk45")
+    } else {  // if(solver_type == "rk45")
+      TORSTEN_PROFILE_SCOPE("integrator::rk45");
       return stan::math::integrate_ode_rk45(f, y0, t0, ts, theta, x, x_int,
                                             msgs,
                                             rel_tol, abs_tol, max_num_steps);
+    }
   }
 };
 
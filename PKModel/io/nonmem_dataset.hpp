@@ -0,0 +1,263 @@
+#ifndef STAN_MATH_TORSTEN_PKMODEL_IO_NONMEM_DATASET_HPP
+#define STAN_MATH_TORSTEN_PKMODEL_IO_NONMEM_DATASET_HPP
+
+#include <stan/math/prim/scal/err/invalid_argument.hpp>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace torsten {
+
+/**
+ * Event schedule of one subject, stored as the columns Torsten
+ * functions take as arguments.
+ */
+struct NonmemSubject {
+  double id;
+  std::vector<double> time, amt, rate, ii;
+  std::vector<int> evid, cmt, addl, ss;
+
+  NonmemSubject() : id(0) { }
+
+  int size() const { return time.size(); }
+
+  void clear() {
+    time.clear(); amt.clear(); rate.clear(); ii.clear();
+    evid.clear(); cmt.clear(); addl.clear(); ss.clear();
+  }
+
+  void reserve(size_t n) {
+    time.reserve(n); amt.reserve(n); rate.reserve(n); ii.reserve(n);
+    evid.reserve(n); cmt.reserve(n); addl.reserve(n); ss.reserve(n);
+  }
+};
+
+/**
+ * Reader for NONMEM formatted data sets (a header line followed by
+ * one line per event, with comma or white space separated fields).
+ *
+ * The file is memory mapped. The constructor makes a single pass
+ * over it to locate the rows and the boundaries between subjects
+ * (consecutive rows with the same ID); fields are only parsed when
+ * a subject is requested, directly from the mapped memory. To
+ * simulate a large population without reallocating, pass the same
+ * NonmemSubject to GetSubject for every subject.
+ *
+ * The columns ID and TIME are required. AMT, RATE, II, EVID, CMT,
+ * ADDL and SS default to 0 when they are absent, and "." is read
+ * as 0, following NONMEM conventions. Column names are case
+ * insensitive, other columns are ignored, and lines starting with
+ * '#' or '@' are skipped.
+ */
+class NonmemDataset {
+private:
+  enum Column { ID, TIME, AMT, RATE, II, EVID, CMT, ADDL, SS, nColumn };
+
+  const char* data_;
+  size_t size_;
+  std::vector<int> index_;  // field index of each column (-1: absent)
+  std::vector<size_t> rows_;  // offset of the start of each row
+  std::vector<size_t> subjects_;  // first row of each subject + end
+  std::vector<double> ids_;
+
+  NonmemDataset(const NonmemDataset&);
+  NonmemDataset& operator=(const NonmemDataset&);
+
+  static bool IsSeparator(char c) {
+    return c == ',' || c == ' ' || c == '\t' || c == '\r';
+  }
+
+  /**
+   * Returns the offset of the start of the next line.
+   */
+  size_t NextLine(size_t pos) const {
+    const void* end = std::memchr(data_ + pos, '\n', size_ - pos);
+    return end ? static_cast<const char*>(end) - data_ + 1 : size_;
+  }
+
+  bool SkipLine(size_t pos) const {
+    size_t p = pos;
+    while (p < size_ && (data_[p] == ' ' || data_[p] == '\t')) p++;
+    return p == size_ || data_[p] == '\n' || data_[p] == '\r'
+      || data_[p] == '#' || data_[p] == '@';
+  }
+
+  /**
+   * Parses the fields of the row starting at pos into values
+   * (one per column, 0 if the column is absent), up to field
+   * lastField.
+   */
+  void ParseRow(size_t pos, double* values, int lastField) const {
+    for (int c = 0; c < nColumn; c++) values[c] = 0;
+    int field = 0;
+    size_t p = pos;
+    while (p < size_ && data_[p] != '\n' && field <= lastField) {
+      while (p < size_ && (data_[p] == ' ' || data_[p] == '\t')) p++;
+      size_t start = p;
+      while (p < size_ && data_[p] != '\n' && !IsSeparator(data_[p])) p++;
+      for (int c = 0; c < nColumn; c++) {
+        if (index_[c] == field && p > start
+            && !(p - start == 1 && data_[start] == '.'))
+          values[c] = ParseField(start, p);
+      }
+      while (p < size_ && (data_[p] == ' ' || data_[p] == '\t'
+                           || data_[p] == '\r')) p++;
+      if (p < size_ && data_[p] == ',') p++;
+      field++;
+    }
+  }
+
+  /**
+   * Parses the field between start and end. strtod stops at the
+   * separator which follows the field; the last field of a file
+   * without a final newline is copied, to not read past the map.
+   */
+  double ParseField(size_t start, size_t end) const {
+    if (end < size_) return std::strtod(data_ + start, 0);
+    return std::strtod(std::string(data_ + start, end - start).c_str(), 0);
+  }
+
+  void ParseHeader(size_t begin, size_t end, const std::string& path) {
+    static const char* names[] = {"ID", "TIME", "AMT", "RATE", "II",
+                                  "EVID", "CMT", "ADDL", "SS"};
+    index_.assign(nColumn, -1);
+    int field = 0;
+    size_t p = begin;
+    while (p < end) {
+      while (p < end && (data_[p] == ' ' || data_[p] == '\t')) p++;
+      size_t start = p;
+      while (p < end && data_[p] != '\n' && !IsSeparator(data_[p])) p++;
+      if (p == start) break;
+      std::string name(data_ + start, p - start);
+      std::transform(name.begin(), name.end(), name.begin(), ::toupper);
+      for (int c = 0; c < nColumn; c++)
+        if (name == names[c]) index_[c] = field;
+      while (p < end && (data_[p] == ' ' || data_[p] == '\t'
+                         || data_[p] == '\r')) p++;
+      if (p < end && data_[p] == ',') p++;
+      field++;
+    }
+
+    static const char* function("NonmemDataset");
+    if (index_[ID] < 0)
+      stan::math::invalid_argument(function, "data set", path, "",
+                                   " has no ID column!");
+    if (index_[TIME] < 0)
+      stan::math::invalid_argument(function, "data set", path, "",
+                                   " has no TIME column!");
+  }
+
+public:
+  /**
+   * Maps the data set in memory and indexes its rows and subjects.
+   *
+   * @param[in] path path to the data set
+   */
+  explicit NonmemDataset(const std::string& path)
+    : data_(0), size_(0) {
+    static const char* function("NonmemDataset");
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+      stan::math::invalid_argument(function, "file", path, "",
+                                   " could not be opened!");
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+      close(fd);
+      stan::math::invalid_argument(function, "file", path, "",
+                                   " is empty or could not be read!");
+    }
+    size_ = st.st_size;
+    void* map = mmap(0, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+      stan::math::invalid_argument(function, "file", path, "",
+                                   " could not be mapped in memory!");
+    data_ = static_cast<const char*>(map);
+    madvise(map, size_, MADV_SEQUENTIAL);
+
+    try {
+      size_t pos = 0;
+      while (pos < size_ && SkipLine(pos)) pos = NextLine(pos);
+      size_t header_end = NextLine(pos);
+      ParseHeader(pos, header_end, path);
+
+      double values[nColumn];
+      for (pos = header_end; pos < size_; pos = NextLine(pos)) {
+        if (SkipLine(pos)) continue;
+        ParseRow(pos, values, index_[ID]);
+        if (ids_.empty() || values[ID] != ids_.back()) {
+          subjects_.push_back(rows_.size());
+          ids_.push_back(values[ID]);
+        }
+        rows_.push_back(pos);
+      }
+      subjects_.push_back(rows_.size());
+    } catch (...) {
+      munmap(const_cast<char*>(data_), size_);
+      throw;
+    }
+  }
+
+  ~NonmemDataset() {
+    if (data_) munmap(const_cast<char*>(data_), size_);
+  }
+
+  int get_n_rows() const { return rows_.size(); }
+
+  int get_n_subjects() const { return ids_.size(); }
+
+  double get_id(int i) const { return ids_[i]; }
+
+  /**
+   * Returns the number of rows of the i-th subject.
+   */
+  int get_n_rows(int i) const { return subjects_[i + 1] - subjects_[i]; }
+
+  /**
+   * Parses the rows of the i-th subject (starting at 0) into subject.
+   * The vectors of subject are reused, so that reading a whole
+   * population does not reallocate them.
+   *
+   * @param[in] i index of the subject
+   * @param[out] subject event schedule of the subject
+   */
+  void GetSubject(int i, NonmemSubject& subject) const {
+    static const char* function("NonmemDataset::GetSubject");
+    if (i < 0 || i >= get_n_subjects())
+      stan::math::invalid_argument(function, "subject index", i, "",
+                                   " is out of range!");
+    subject.clear();
+    subject.reserve(get_n_rows(i));
+    subject.id = ids_[i];
+    double values[nColumn];
+    int lastField = *std::max_element(index_.begin(), index_.end());
+    for (size_t r = subjects_[i]; r < subjects_[i + 1]; r++) {
+      ParseRow(rows_[r], values, lastField);
+      subject.time.push_back(values[TIME]);
+      subject.amt.push_back(values[AMT]);
+      subject.rate.push_back(values[RATE]);
+      subject.ii.push_back(values[II]);
+      subject.evid.push_back(static_cast<int>(values[EVID]));
+      subject.cmt.push_back(static_cast<int>(values[CMT]));
+      subject.addl.push_back(static_cast<int>(values[ADDL]));
+      subject.ss.push_back(static_cast<int>(values[SS]));
+    }
+  }
+
+  NonmemSubject GetSubject(int i) const {
+    NonmemSubject subject;
+    GetSubject(i, subject);
+    return subject;
+  }
+};
+
+}  // torsten namespace
+
+#endif
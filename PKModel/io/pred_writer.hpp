@@ -0,0 +1,200 @@
+#ifndef STAN_MATH_TORSTEN_PKMODEL_IO_PRED_WRITER_HPP
+#define STAN_MATH_TORSTEN_PKMODEL_IO_PRED_WRITER_HPP
+
+#include <stan/math/torsten/PKModel/PredSink.hpp>
+#include <stan/math/prim/scal/err/invalid_argument.hpp>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace torsten {
+
+/**
+ * PredSink which writes the predictions to a file, through a
+ * buffer of fixed size, so that the memory used does not depend on
+ * the number of predictions.
+ *
+ * Only the selected compartments (starting at 1, all of them by
+ * default) are written, followed by the AUCs the model function
+ * returns (see the argument auc_cmt), for each prediction:
+ *    csv: a line "id,time,A<cmt>...,AUC<cmt>..." after a header line
+ *    binary: the doubles id, time, the amounts and the AUCs. The
+ *            records follow a header: magic "TRPRED" (8 bytes, null
+ *            terminated), format version (uint32), number of
+ *            compartments written (uint32) and number of AUCs
+ *            (uint32), in the byte order of the machine which
+ *            wrote the file.
+ *
+ * The header is written with the first prediction, once the layout
+ * of the predictions is known (see PredSink::SetLayout). The buffer
+ * is flushed when it is full and when the writer is closed or
+ * destroyed.
+ */
+class PredWriter : public PredSink {
+public:
+  enum Format { csv, binary };
+
+private:
+  std::FILE* file_;
+  std::string path_;
+  Format format_;
+  std::vector<int> cmts_;
+  int nCmt_;                  // compartments of the model (-1: unknown)
+  std::vector<int> auc_cmt_;  // compartments of the AUCs
+  std::vector<char> buffer_;
+  size_t used_;
+  bool header_;
+
+  PredWriter(const PredWriter&);
+  PredWriter& operator=(const PredWriter&);
+
+  void Append(const void* data, size_t size) {
+    if (used_ + size > buffer_.size()) Flush();
+    if (size > buffer_.size()) {
+      if (std::fwrite(data, 1, size, file_) != size)
+        Fail(" could not be written!");
+      return;
+    }
+    std::memcpy(&buffer_[used_], data, size);
+    used_ += size;
+  }
+
+  void Append(const std::string& text) { Append(text.data(), text.size()); }
+
+  void Append(double x) {
+    char text[32];
+    int n = std::snprintf(text, sizeof(text), "%.17g", x);
+    Append(text, n);
+  }
+
+  void WriteHeader() {
+    static const char* function("PredWriter");
+    if (cmts_.empty())
+      for (int j = 1; j <= nCmt_; j++) cmts_.push_back(j);
+    for (size_t j = 0; j < cmts_.size(); j++)
+      if (cmts_[j] < 1 || cmts_[j] > nCmt_)
+        stan::math::invalid_argument(function, "compartment", cmts_[j], "",
+                                     " is not a compartment of the model!");
+
+    if (format_ == binary) {
+      unsigned int version = 2, n = cmts_.size(), nAuc = auc_cmt_.size();
+      Append("TRPRED\0\0", 8);
+      Append(&version, sizeof(version));
+      Append(&n, sizeof(n));
+      Append(&nAuc, sizeof(nAuc));
+    } else {
+      Append(std::string("id,time"));
+      char name[32];
+      for (size_t j = 0; j < cmts_.size(); j++) {
+        int n = std::snprintf(name, sizeof(name), ",A%d", cmts_[j]);
+        Append(name, n);
+      }
+      for (size_t j = 0; j < auc_cmt_.size(); j++) {
+        int n = std::snprintf(name, sizeof(name), ",AUC%d", auc_cmt_[j]);
+        Append(name, n);
+      }
+      Append(std::string("\n"));
+    }
+    header_ = true;
+  }
+
+  void Fail(const char* message) {
+    stan::math::invalid_argument("PredWriter", "file", path_, "", message);
+  }
+
+public:
+  /**
+   * Opens the output file.
+   *
+   * @param[in] path path of the output file
+   * @param[in] format csv or binary
+   * @param[in] cmts compartments to write (starting at 1, all
+   *            compartments if empty)
+   * @param[in] buffer_size size of the buffer, in bytes
+   */
+  explicit PredWriter(const std::string& path,
+                      Format format = csv,
+                      const std::vector<int>& cmts = std::vector<int>(),
+                      size_t buffer_size = 1 << 20)
+    : file_(0), path_(path), format_(format), cmts_(cmts), nCmt_(-1),
+      buffer_(buffer_size > 0 ? buffer_size : 1), used_(0), header_(false) {
+    file_ = std::fopen(path.c_str(), format == binary ? "wb" : "w");
+    if (!file_) Fail(" could not be opened!");
+  }
+
+  ~PredWriter() {
+    if (file_) {
+      if (used_ > 0) std::fwrite(&buffer_[0], 1, used_, file_);
+      std::fclose(file_);
+    }
+  }
+
+  /**
+   * Records the layout of the predictions. All the predictions
+   * written to a file must have the same layout.
+   */
+  void SetLayout(int nCmt, const std::vector<int>& auc_cmt) {
+    if (nCmt_ >= 0 && (nCmt != nCmt_ || auc_cmt != auc_cmt_))
+      Fail(" receives predictions with different compartments or AUCs!");
+    nCmt_ = nCmt;
+    auc_cmt_ = auc_cmt;
+  }
+
+  /**
+   * Writes a prediction. Without a layout (see SetLayout), all the
+   * amounts are taken as compartments.
+   */
+  void Write(double id, double time, const std::vector<double>& amounts) {
+    if (!file_) Fail(" is closed!");
+    if (nCmt_ < 0) nCmt_ = amounts.size();
+    if (amounts.size() != static_cast<size_t>(nCmt_) + auc_cmt_.size())
+      Fail(" receives predictions of the wrong length!");
+    if (!header_) WriteHeader();
+    if (format_ == binary) {
+      Append(&id, sizeof(id));
+      Append(&time, sizeof(time));
+      for (size_t j = 0; j < cmts_.size(); j++)
+        Append(&amounts[cmts_[j] - 1], sizeof(double));
+      if (!auc_cmt_.empty())
+        Append(&amounts[nCmt_], auc_cmt_.size() * sizeof(double));
+    } else {
+      Append(id);
+      Append(",", 1);
+      Append(time);
+      for (size_t j = 0; j < cmts_.size(); j++) {
+        Append(",", 1);
+        Append(amounts[cmts_[j] - 1]);
+      }
+      for (size_t j = 0; j < auc_cmt_.size(); j++) {
+        Append(",", 1);
+        Append(amounts[nCmt_ + j]);
+      }
+      Append("\n", 1);
+    }
+  }
+
+  /**
+   * Writes the content of the buffer to the file.
+   */
+  void Flush() {
+    if (used_ > 0 && std::fwrite(&buffer_[0], 1, used_, file_) != used_)
+      Fail(" could not be written!");
+    used_ = 0;
+  }
+
+  /**
+   * Flushes the buffer and closes the file.
+   */
+  void Close() {
+    if (!file_) return;
+    Flush();
+    int status = std::fclose(file_);
+    file_ = 0;
+    if (status != 0) Fail(" could not be written!");
+  }
+};
+
+}  // torsten namespace
+
+#endif
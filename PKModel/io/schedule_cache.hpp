@@ -0,0 +1,181 @@
+#ifndef STAN_MATH_TORSTEN_PKMODEL_IO_SCHEDULE_CACHE_HPP
+#define STAN_MATH_TORSTEN_PKMODEL_IO_SCHEDULE_CACHE_HPP
+
+#include <stan/math/torsten/PKModel/EventSchedule.hpp>
+#include <stan/math/prim/scal/err/invalid_argument.hpp>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace torsten {
+
+/**
+ * Binary cache of compiled event schedules (see EventSchedule),
+ * e.g. one per subject of a population.
+ *
+ * Layout of the file, in the byte order of the machine which
+ * wrote it:
+ *    magic "TRSCHED" (8 bytes, null terminated)
+ *    format version (uint32) and byte order mark (uint32)
+ *    number of schedules n (uint64)
+ *    n + 1 offsets (uint64) of the schedules from the start of the file
+ *    the schedules, as written by EventSchedule::Write
+ *
+ * Files written with a different version or byte order are rejected.
+ * The version changes with the layout of EventSchedule::Write:
+ *    1: columns of the events and rate table
+ *    2: same, preceded by the ID of the subject
+ *    3: same, followed by the trains of additional doses
+ *    4: same, with the time tolerance after the ID
+ */
+struct ScheduleCacheFormat {
+  static const char* magic() { return "TRSCHED"; }
+  static unsigned int version() { return 4; }
+  static unsigned int byte_order() { return 0x01020304; }
+  static size_t header_size() { return 8 + 2 * 4 + 8; }
+};
+
+/**
+ * Writes compiled event schedules to a cache file.
+ *
+ * @param[in] path path of the cache file
+ * @param[in] schedules compiled event schedules
+ */
+inline void WriteScheduleCache(const std::string& path,
+                               const std::vector<EventSchedule>& schedules) {
+  typedef unsigned long long uint64;  // NOLINT(runtime/int)
+  static const char* function("WriteScheduleCache");
+  std::ofstream out(path.c_str(), std::ios::binary | std::ios::trunc);
+  if (!out)
+    stan::math::invalid_argument(function, "file", path, "",
+                                 " could not be opened!");
+
+  unsigned int version = ScheduleCacheFormat::version(),
+    byte_order = ScheduleCacheFormat::byte_order();
+  uint64 n = schedules.size();
+  out.write(ScheduleCacheFormat::magic(), 8);
+  out.write(reinterpret_cast<const char*>(&version), sizeof(version));
+  out.write(reinterpret_cast<const char*>(&byte_order), sizeof(byte_order));
+  out.write(reinterpret_cast<const char*>(&n), sizeof(n));
+
+  // offsets are filled in once the schedules are written.
+  std::vector<uint64> offsets(n + 1, 0);
+  std::streampos offsets_pos = out.tellp();
+  out.write(reinterpret_cast<const char*>(&offsets[0]),
+            offsets.size() * sizeof(uint64));
+  for (size_t i = 0; i < schedules.size(); i++) {
+    offsets[i] = out.tellp();
+    schedules[i].Write(out);
+  }
+  offsets[n] = out.tellp();
+  out.seekp(offsets_pos);
+  out.write(reinterpret_cast<const char*>(&offsets[0]),
+            offsets.size() * sizeof(uint64));
+
+  if (!out)
+    stan::math::invalid_argument(function, "file", path, "",
+                                 " could not be written!");
+}
+
+/**
+ * Reader for a cache file written by WriteScheduleCache. The file
+ * is memory mapped, and schedules are only read when requested.
+ */
+class ScheduleCache {
+private:
+  typedef unsigned long long uint64;  // NOLINT(runtime/int)
+  const char* data_;
+  size_t size_;
+  uint64 n_;
+  const char* offsets_;
+
+  ScheduleCache(const ScheduleCache&);
+  ScheduleCache& operator=(const ScheduleCache&);
+
+  uint64 offset(size_t i) const {
+    uint64 x;
+    std::memcpy(&x, offsets_ + i * sizeof(uint64), sizeof(uint64));
+    return x;
+  }
+
+  void Fail(const std::string& path, const char* message) {
+    if (data_) munmap(const_cast<char*>(data_), size_);
+    data_ = 0;
+    stan::math::invalid_argument("ScheduleCache", "file", path, "", message);
+  }
+
+public:
+  explicit ScheduleCache(const std::string& path)
+    : data_(0), size_(0), n_(0), offsets_(0) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) Fail(path, " could not be opened!");
+    struct stat st;
+    if (fstat(fd, &st) != 0
+        || static_cast<size_t>(st.st_size) < ScheduleCacheFormat::header_size()) {  // NOLINT
+      close(fd);
+      Fail(path, " is not a schedule cache!");
+    }
+    size_ = st.st_size;
+    void* map = mmap(0, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) Fail(path, " could not be mapped in memory!");
+    data_ = static_cast<const char*>(map);
+
+    unsigned int version, byte_order;
+    if (std::memcmp(data_, ScheduleCacheFormat::magic(), 8) != 0)
+      Fail(path, " is not a schedule cache!");
+    std::memcpy(&version, data_ + 8, sizeof(version));
+    std::memcpy(&byte_order, data_ + 12, sizeof(byte_order));
+    if (byte_order != ScheduleCacheFormat::byte_order())
+      Fail(path, " was written on a machine with a different byte order!");
+    if (version != ScheduleCacheFormat::version())
+      Fail(path, " was written with an unsupported version of the format!");
+    std::memcpy(&n_, data_ + 16, sizeof(n_));
+    offsets_ = data_ + ScheduleCacheFormat::header_size();
+    if ((size_ - ScheduleCacheFormat::header_size()) / sizeof(uint64)
+        < n_ + 1 || offset(n_) > size_)
+      Fail(path, " is truncated!");
+  }
+
+  ~ScheduleCache() {
+    if (data_) munmap(const_cast<char*>(data_), size_);
+  }
+
+  int get_size() const { return n_; }
+
+  /**
+   * Reads the i-th schedule (starting at 0) of the cache.
+   */
+  void GetSchedule(int i, EventSchedule& schedule) const {
+    if (i < 0 || static_cast<uint64>(i) >= n_)
+      stan::math::invalid_argument("ScheduleCache::GetSchedule",
+                                   "schedule index", i, "",
+                                   " is out of range!");
+    schedule.Read(data_ + offset(i), data_ + offset(i + 1));
+  }
+
+  EventSchedule GetSchedule(int i) const {
+    EventSchedule schedule;
+    GetSchedule(i, schedule);
+    return schedule;
+  }
+
+  /**
+   * Reads all the schedules of the cache.
+   */
+  std::vector<EventSchedule> GetSchedules() const {
+    std::vector<EventSchedule> schedules(n_);
+    for (size_t i = 0; i < schedules.size(); i++)
+      GetSchedule(i, schedules[i]);
+    return schedules;
+  }
+};
+
+}  // torsten namespace
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef STAN_MATH_TORSTEN_PKMODEL_PRESERVES_ZERO_STATE_HPP
+#define STAN_MATH_TORSTEN_PKMODEL_PRESERVES_ZERO_STATE_HPP
+
+#include <boost/type_traits/integral_constant.hpp>
+
+namespace torsten {
+
+/**
+ * True if the Pred1 functor F returns zero amounts (and AUCs) from
+ * zero amounts and zero rates, so that Pred can skip the events
+ * before the first dose. This is false by default, since the ODE
+ * of a general or mix model may have a non zero right hand side at
+ * zero amounts (e.g. an endogenous production). The analytic and
+ * linear ODE models specialize it next to their functors.
+ */
+template <typename F>
+struct preserves_zero_state : boost::false_type { };
+
+}
+
+#endif
@@ -0,0 +1,155 @@
+#ifndef STAN_MATH_TORSTEN_PKMODEL_PROFILE_HPP
+#define STAN_MATH_TORSTEN_PKMODEL_PROFILE_HPP
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace torsten {
+
+/**
+ * Aggregated timings of the phases of Torsten functions.
+ *
+ * Timers are only compiled in when TORSTEN_PROFILE is defined
+ * before including Torsten. Each timed section is identified by a
+ * name (e.g. "Pred::Pred1" or "integrator::bdf"); the profile
+ * records how many times the section was entered and the total
+ * wall time spent in it. Without TORSTEN_PROFILE, the profile
+ * stays empty and the timers cost nothing.
+ *
+ * The profile of the current thread is accessed with GetProfile(),
+ * and can be queried or printed after a fit, then reset.
+ */
+class Profile {
+private:
+  struct Entry {
+    long int count;  // NOLINT(runtime/int)
+    double time;
+    Entry() : count(0), time(0) { }
+  };
+  std::map<std::string, Entry> entries_;
+
+public:
+  void Add(const std::string& name, double seconds) {
+    Entry& entry = entries_[name];
+    entry.count++;
+    entry.time += seconds;
+  }
+
+  void Reset() { entries_.clear(); }
+
+  bool empty() const { return entries_.empty(); }
+
+  /**
+   * Returns the names of the timed sections, in alphabetical order.
+   */
+  std::vector<std::string> get_names() const {
+    std::vector<std::string> names;
+    for (std::map<std::string, Entry>::const_iterator it = entries_.begin();
+         it != entries_.end(); ++it)
+      names.push_back(it->first);
+    return names;
+  }
+
+  /**
+   * Returns the number of times a section was entered
+   * (0 if it never was).
+   */
+  long int get_count(const std::string& name) const {  // NOLINT
+    std::map<std::string, Entry>::const_iterator it = entries_.find(name);
+    return (it == entries_.end()) ? 0 : it->second.count;
+  }
+
+  /**
+   * Returns the total time, in seconds, spent in a section
+   * (0 if it never was entered).
+   */
+  double get_time(const std::string& name) const {
+    std::map<std::string, Entry>::const_iterator it = entries_.find(name);
+    return (it == entries_.end()) ? 0 : it->second.time;
+  }
+
+  /**
+   * Prints one line per section, with the number of calls, the
+   * total time and the average time per call.
+   */
+  void Print(std::ostream& out) const {
+    out << std::left << std::setw(28) << "section"
+        << std::right << std::setw(12) << "calls"
+        << std::setw(14) << "total (s)"
+        << std::setw(14) << "mean (s)" << std::endl;
+    for (std::map<std::string, Entry>::const_iterator it = entries_.begin();
+         it != entries_.end(); ++it) {
+      out << std::left << std::setw(28) << it->first
+          << std::right << std::setw(12) << it->second.count
+          << std::setw(14) << it->second.time
+          << std::setw(14) << it->second.time / it->second.count
+          << std::endl;
+    }
+  }
+};
+
+/**
+ * Returns the profile of the calling thread.
+ */
+inline Profile& GetProfile() {
+  static thread_local Profile profile;
+  return profile;
+}
+
+/**
+ * Times a section of code and adds the elapsed time to the
+ * profile of the calling thread, either when Stop() is called
+ * or when the timer goes out of scope.
+ */
+class ProfileTimer {
+private:
+  typedef std::chrono::steady_clock clock;
+  const char* name_;
+  clock::time_point start_;
+  bool running_;
+
+public:
+  explicit ProfileTimer(const char* name)
+    : name_(name), start_(clock::now()), running_(true) { }
+
+  void Stop() {
+    if (running_) {
+      GetProfile().Add(name_,
+        std::chrono::duration<double>(clock::now() - start_).count());
+      running_ = false;
+    }
+  }
+
+  ~ProfileTimer() { Stop(); }
+};
+
+}  // torsten namespace
+
+#define TORSTEN_PROFILE_CONCAT_(a, b) a ## b
+#define TORSTEN_PROFILE_CONCAT(a, b) TORSTEN_PROFILE_CONCAT_(a, b)
+
+#ifdef TORSTEN_PROFILE
+/**
+ * Times the rest of the enclosing scope under the given name.
+ */
+#define TORSTEN_PROFILE_SCOPE(name) \
+  ::torsten::ProfileTimer \
+    TORSTEN_PROFILE_CONCAT(torsten_profile_timer_, __LINE__)(name)
+/**
+ * Starts and stops a named timer, for sections which declare
+ * variables used after the section ends.
+ */
+#define TORSTEN_PROFILE_START(timer, name) \
+  ::torsten::ProfileTimer timer(name)
+#define TORSTEN_PROFILE_STOP(timer) timer.Stop()
+#else
+#define TORSTEN_PROFILE_SCOPE(name)
+#define TORSTEN_PROFILE_START(timer, name)
+#define TORSTEN_PROFILE_STOP(timer)
+#endif
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef STAN_MATH_TORSTEN_PKMODEL_SAME_VALUE_HPP
+#define STAN_MATH_TORSTEN_PKMODEL_SAME_VALUE_HPP
+
+#include <stan/math/rev/core.hpp>
+#include <stan/math/fwd/core.hpp>
+#include <Eigen/Dense>
+#include <vector>
+
+namespace torsten {
+
+/**
+ * Returns true if two parameters can be used in place of one
+ * another, without changing the predictions nor their gradients.
+ * Data are compared by value, and autodiff variables by identity:
+ * two distinct variables which happen to have the same value are
+ * not interchangeable, since their adjoints differ.
+ *
+ * Forward mode variables are compared through their values and
+ * tangents, each compared as above. Other scalar types are never
+ * deemed identical.
+ */
+template <typename T>
+inline bool same_value(const T& a, const T& b) {
+  return false;
+}
+
+inline bool same_value(double a, double b) {
+  return a == b;
+}
+
+inline bool same_value(const stan::math::var& a, const stan::math::var& b) {
+  return a.vi_ == b.vi_;
+}
+
+template <typename T>
+inline bool same_value(const stan::math::fvar<T>& a,
+                       const stan::math::fvar<T>& b) {
+  return same_value(a.val_, b.val_) && same_value(a.d_, b.d_);
+}
+
+template <typename T>
+inline bool same_value(const std::vector<T>& a, const std::vector<T>& b) {
+  if (&a == &b) return true;
+  if (a.size() != b.size()) return false;
+  for (size_t i = 0; i < a.size(); i++)
+    if (!same_value(a[i], b[i])) return false;
+  return true;
+}
+
+template <typename T>
+inline bool
+same_value(const Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>& a,
+           const Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>& b) {
+  if (&a == &b) return true;
+  if (a.rows() != b.rows() || a.cols() != b.cols()) return false;
+  for (int i = 0; i < a.size(); i++)
+    if (!same_value(a(i), b(i))) return false;
+  return true;
+}
+
+}
+
+#endif
@@ -0,0 +1,178 @@
+#ifndef STAN_MATH_TORSTEN_PKMODEL_TAPE_FOOTPRINT_HPP
+#define STAN_MATH_TORSTEN_PKMODEL_TAPE_FOOTPRINT_HPP
+
+#include <stan/math/rev/core.hpp>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace torsten {
+
+/**
+ * Size of the autodiff tape at a given point: the number of vari
+ * nodes on the stacks and the number of bytes the arena obtained
+ * from the heap.
+ *
+ * The arena grows by blocks, so the bytes attributed to a call are
+ * the blocks it caused to be allocated, not the exact memory used
+ * by its nodes.
+ */
+struct TapeSnapshot {
+  size_t nodes;
+  size_t bytes;
+
+  TapeSnapshot() : nodes(0), bytes(0) { }
+};
+
+/**
+ * Returns the current size of the autodiff tape.
+ */
+inline TapeSnapshot GetTapeSnapshot() {
+  using stan::math::ChainableStack;
+  TapeSnapshot snapshot;
+  snapshot.nodes = ChainableStack::var_stack_.size()
+    + ChainableStack::var_nochain_stack_.size();
+  snapshot.bytes = ChainableStack::memalloc_.bytes_allocated();
+  return snapshot;
+}
+
+/**
+ * Growth of the autodiff tape attributed to Torsten functions
+ * and to the phases of Pred.
+ *
+ * Records are only made when TORSTEN_TAPE_FOOTPRINT is defined
+ * before including Torsten. Each record is identified by a name:
+ * the name of the model function (e.g. "PKModelOneCpt") or of the
+ * phase of Pred (e.g. "Pred::Pred1"). The footprint of the current
+ * thread is accessed with GetTapeFootprint(). Call Print() at the
+ * end of a gradient evaluation, before the tape is recovered, to
+ * also report the total size of the tape.
+ */
+class TapeFootprint {
+private:
+  struct Entry {
+    long int count;  // NOLINT(runtime/int)
+    size_t nodes, bytes;
+    Entry() : count(0), nodes(0), bytes(0) { }
+  };
+  std::map<std::string, Entry> entries_;
+
+public:
+  void Add(const std::string& name, const TapeSnapshot& start,
+           const TapeSnapshot& end) {
+    Entry& entry = entries_[name];
+    entry.count++;
+    // nested autodiff can leave the tape smaller than it found it.
+    if (end.nodes > start.nodes) entry.nodes += end.nodes - start.nodes;
+    if (end.bytes > start.bytes) entry.bytes += end.bytes - start.bytes;
+  }
+
+  void Reset() { entries_.clear(); }
+
+  bool empty() const { return entries_.empty(); }
+
+  std::vector<std::string> get_names() const {
+    std::vector<std::string> names;
+    for (std::map<std::string, Entry>::const_iterator it = entries_.begin();
+         it != entries_.end(); ++it)
+      names.push_back(it->first);
+    return names;
+  }
+
+  long int get_count(const std::string& name) const {  // NOLINT
+    std::map<std::string, Entry>::const_iterator it = entries_.find(name);
+    return (it == entries_.end()) ? 0 : it->second.count;
+  }
+
+  /**
+   * Returns the number of vari nodes added to the tape under name.
+   */
+  size_t get_nodes(const std::string& name) const {
+    std::map<std::string, Entry>::const_iterator it = entries_.find(name);
+    return (it == entries_.end()) ? 0 : it->second.nodes;
+  }
+
+  /**
+   * Returns the number of arena bytes allocated under name.
+   */
+  size_t get_bytes(const std::string& name) const {
+    std::map<std::string, Entry>::const_iterator it = entries_.find(name);
+    return (it == entries_.end()) ? 0 : it->second.bytes;
+  }
+
+  /**
+   * Prints one line per record, followed by the current total
+   * size of the tape.
+   */
+  void Print(std::ostream& out) const {
+    out << std::left << std::setw(28) << "section"
+        << std::right << std::setw(12) << "calls"
+        << std::setw(14) << "vari nodes"
+        << std::setw(14) << "arena bytes" << std::endl;
+    for (std::map<std::string, Entry>::const_iterator it = entries_.begin();
+         it != entries_.end(); ++it) {
+      out << std::left << std::setw(28) << it->first
+          << std::right << std::setw(12) << it->second.count
+          << std::setw(14) << it->second.nodes
+          << std::setw(14) << it->second.bytes << std::endl;
+    }
+    TapeSnapshot total = GetTapeSnapshot();
+    out << std::left << std::setw(28) << "total tape"
+        << std::right << std::setw(12) << ""
+        << std::setw(14) << total.nodes
+        << std::setw(14) << total.bytes << std::endl;
+  }
+};
+
+/**
+ * Returns the tape footprint of the calling thread.
+ */
+inline TapeFootprint& GetTapeFootprint() {
+  static thread_local TapeFootprint footprint;
+  return footprint;
+}
+
+/**
+ * Records the growth of the tape between its construction and
+ * either a call to Stop() or the end of its scope.
+ */
+class TapeScope {
+private:
+  const char* name_;
+  TapeSnapshot start_;
+  bool running_;
+
+public:
+  explicit TapeScope(const char* name)
+    : name_(name), start_(GetTapeSnapshot()), running_(true) { }
+
+  void Stop() {
+    if (running_) {
+      GetTapeFootprint().Add(name_, start_, GetTapeSnapshot());
+      running_ = false;
+    }
+  }
+
+  ~TapeScope() { Stop(); }
+};
+
+}  // torsten namespace
+
+#define TORSTEN_TAPE_CONCAT_(a, b) a ## b
+#define TORSTEN_TAPE_CONCAT(a, b) TORSTEN_TAPE_CONCAT_(a, b)
+
+#ifdef TORSTEN_TAPE_FOOTPRINT
+#define TORSTEN_TAPE_SCOPE(name) \
+  ::torsten::TapeScope \
+    TORSTEN_TAPE_CONCAT(torsten_tape_scope_, __LINE__)(name)
+#define TORSTEN_TAPE_START(scope, name) ::torsten::TapeScope scope(name)
+#define TORSTEN_TAPE_STOP(scope) scope.Stop()
+#else
+#define TORSTEN_TAPE_SCOPE(name)
+#define TORSTEN_TAPE_START(scope, name)
+#define TORSTEN_TAPE_STOP(scope)
+#endif
+
+#endif
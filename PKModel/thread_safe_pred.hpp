@@ -0,0 +1,22 @@
+#ifndef STAN_MATH_TORSTEN_PKMODEL_THREAD_SAFE_PRED_HPP
+#define STAN_MATH_TORSTEN_PKMODEL_THREAD_SAFE_PRED_HPP
+
+#include <boost/type_traits/integral_constant.hpp>
+
+namespace torsten {
+
+/**
+ * True if the Pred1 or PredSS functor F can be called from several
+ * threads at once when the parameters are data. This is false by
+ * default: the models based on the ODE integrators and on the
+ * algebraic solver compute Jacobians with nested autodiff, on the
+ * autodiff stack of Stan, which is shared by the threads. The
+ * analytic and linear ODE models specialize it next to their
+ * functors.
+ */
+template <typename F>
+struct thread_safe_pred : boost::false_type { };
+
+}
+
+#endif
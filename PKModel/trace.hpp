@@ -0,0 +1,242 @@
+#ifndef STAN_MATH_TORSTEN_PKMODEL_TRACE_HPP
+#define STAN_MATH_TORSTEN_PKMODEL_TRACE_HPP
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <typeinfo>
+#ifdef __GNUG__
+#include <cxxabi.h>
+#include <cstdlib>
+#endif
+
+namespace torsten {
+
+/**
+ * Number of evaluations of ODE right-hand sides by the
+ * integrators, on the calling thread. Incremented by the
+ * functors passed to the integrators when TORSTEN_TRACE is
+ * defined.
+ */
+inline long int& RhsEvaluations() {  // NOLINT(runtime/int)
+  static thread_local long int count = 0;  // NOLINT(runtime/int)
+  return count;
+}
+
+/**
+ * Demangled name of a type, if the compiler supports it.
+ */
+inline std::string DemangleName(const char* name) {
+#ifdef __GNUG__
+  int status = 0;
+  char* demangled = abi::__cxa_demangle(name, 0, 0, &status);
+  if (status == 0 && demangled) {
+    std::string result(demangled);
+    std::free(demangled);
+    return result;
+  }
+#endif
+  return name;
+}
+
+/**
+ * Readable name of a type, used to identify the Pred1 and PredSS
+ * functors in traces. The name is demangled once per type.
+ */
+template <typename F>
+const std::string& FunctorName() {
+  static const std::string name = DemangleName(typeid(F).name());
+  return name;
+}
+
+/**
+ * Writes a string as a JSON string literal, with its quotes.
+ */
+inline void WriteJsonString(std::ostream& out, const std::string& value) {
+  out << '"';
+  for (size_t i = 0; i < value.size(); i++) {
+    char c = value[i];
+    if (c == '"' || c == '\\') {
+      out << '\\' << c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char escaped[8];
+      std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+      out << escaped;
+    } else {
+      out << c;
+    }
+  }
+  out << '"';
+}
+
+/**
+ * Writes a number as a JSON value: null if it is not finite, which
+ * JSON cannot represent, and with all its digits otherwise.
+ */
+inline void WriteJsonNumber(std::ostream& out, double value) {
+  if (!std::isfinite(value)) {
+    out << "null";
+  } else {
+    std::streamsize precision = out.precision(17);
+    out << value;
+    out.precision(precision);
+  }
+}
+
+/**
+ * Writer for traces in the Chrome trace event format (JSON array),
+ * which can be loaded in chrome://tracing or Perfetto.
+ *
+ * Tracing is only compiled in when TORSTEN_TRACE is defined, and
+ * only writes when a stream was registered with Open() on the
+ * calling thread. Open() writes the head of the array and Close()
+ * its end; the stream must stay valid in between.
+ */
+class Trace {
+private:
+  typedef std::chrono::steady_clock clock;
+  std::ostream* out_;
+  bool first_;
+  clock::time_point origin_;
+
+public:
+  Trace() : out_(0), first_(true), origin_(clock::now()) { }
+
+  void Open(std::ostream* out) {
+    Close();
+    out_ = out;
+    first_ = true;
+    origin_ = clock::now();
+    *out_ << "[";
+  }
+
+  void Close() {
+    if (out_) {
+      *out_ << "\n]\n";
+      out_->flush();
+      out_ = 0;
+    }
+  }
+
+  bool active() const { return out_ != 0; }
+
+  /**
+   * Microseconds elapsed between the opening of the trace and t.
+   */
+  double Microseconds(const clock::time_point& t) const {
+    return std::chrono::duration<double, std::micro>(t - origin_).count();
+  }
+
+  /**
+   * Writes a complete event ("ph": "X").
+   *
+   * @param[in] name name of the span
+   * @param[in] start start time of the span
+   * @param[in] end end time of the span
+   * @param[in] args comma separated JSON members for the args object
+   */
+  void Write(const char* name, const clock::time_point& start,
+             const clock::time_point& end, const std::string& args) {
+    if (!out_) return;
+    // the times are written in fixed notation, to the nanosecond,
+    // so that long traces keep the order of their spans.
+    std::ios_base::fmtflags flags = out_->flags();
+    std::streamsize precision = out_->precision(3);
+    *out_ << (first_ ? "\n" : ",\n") << "{\"name\":";
+    WriteJsonString(*out_, name);
+    *out_ << ",\"cat\":\"torsten\",\"ph\":\"X\"" << std::fixed
+          << ",\"ts\":" << Microseconds(start)
+          << ",\"dur\":" << Microseconds(end) - Microseconds(start)
+          << ",\"pid\":1,\"tid\":"
+          << std::hash<std::thread::id>()(std::this_thread::get_id()) % 100000
+          << ",\"args\":{" << args << "}}";
+    out_->flags(flags);
+    out_->precision(precision);
+    first_ = false;
+  }
+
+  ~Trace() { Close(); }
+};
+
+/**
+ * Returns the trace of the calling thread.
+ */
+inline Trace& GetTrace() {
+  static thread_local Trace trace;
+  return trace;
+}
+
+/**
+ * A span of the trace, written when it goes out of scope. Records
+ * the arguments passed with Arg() and the number of ODE right-hand
+ * side evaluations during the span. Does nothing if no trace stream
+ * is open.
+ */
+class TraceSpan {
+private:
+  typedef std::chrono::steady_clock clock;
+  const char* name_;
+  bool active_;
+  clock::time_point start_;
+  long int rhs0_;  // NOLINT(runtime/int)
+  std::ostringstream args_;
+
+public:
+  explicit TraceSpan(const char* name)
+    : name_(name), active_(GetTrace().active()) {
+    if (active_) {
+      rhs0_ = RhsEvaluations();
+      start_ = clock::now();
+    }
+  }
+
+  void Arg(const char* key, double value) {
+    if (!active_) return;
+    WriteJsonString(args_, key);
+    args_ << ":";
+    WriteJsonNumber(args_, value);
+    args_ << ",";
+  }
+
+  void Arg(const char* key, int value) {
+    if (!active_) return;
+    WriteJsonString(args_, key);
+    args_ << ":" << value << ",";
+  }
+
+  void Arg(const char* key, const std::string& value) {
+    if (!active_) return;
+    WriteJsonString(args_, key);
+    args_ << ":";
+    WriteJsonString(args_, value);
+    args_ << ",";
+  }
+
+  ~TraceSpan() {
+    if (active_) {
+      clock::time_point end = clock::now();
+      args_ << "\"rhs_evaluations\":" << RhsEvaluations() - rhs0_;
+      GetTrace().Write(name_, start_, end, args_.str());
+    }
+  }
+};
+
+}  // torsten namespace
+
+#ifdef TORSTEN_TRACE
+#define TORSTEN_TRACE_SPAN(span, name) ::torsten::TraceSpan span(name)
+#define TORSTEN_TRACE_ARG(span, key, value) span.Arg(key, value)
+#define TORSTEN_TRACE_COUNT_RHS() ++::torsten::RhsEvaluations()
+#else
+#define TORSTEN_TRACE_SPAN(span, name)
+#define TORSTEN_TRACE_ARG(span, key, value)
+#define TORSTEN_TRACE_COUNT_RHS()
+#endif
+
+#endif
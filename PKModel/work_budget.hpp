@@ -0,0 +1,188 @@
+#ifndef STAN_MATH_TORSTEN_PKMODEL_WORK_BUDGET_HPP
+#define STAN_MATH_TORSTEN_PKMODEL_WORK_BUDGET_HPP
+
+#include <stan/math/torsten/PKModel/Pred/unpromote.hpp>
+#include <stan/math/prim/scal/err/domain_error.hpp>
+#include <stan/math/prim/scal/err/invalid_argument.hpp>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+// Default limits of the work budget (0: no limit), which can be set
+// when compiling a model, since the budget cannot be configured from
+// the Stan language.
+#ifndef TORSTEN_MAX_RHS_EVALUATIONS
+#define TORSTEN_MAX_RHS_EVALUATIONS 0
+#endif
+#ifndef TORSTEN_MAX_PRED_SECONDS
+#define TORSTEN_MAX_PRED_SECONDS 0
+#endif
+#ifndef TORSTEN_DIVERGENCE_BOUND
+#define TORSTEN_DIVERGENCE_BOUND 0
+#endif
+
+namespace torsten {
+
+/**
+ * Work budget of a call to Pred with an ODE based model
+ * (generalOdeModel_*, mixOde*).
+ *
+ * With extreme parameters, such as those proposed during the warmup
+ * of a sampler, the ODE solvers may take their maximum number of
+ * steps at each event before failing, and stall the chain. The
+ * budget bounds the work of the whole call, shared by all its
+ * events: the number of evaluations of the right hand side of the
+ * ODE and the wall time. It also rejects the states which diverge,
+ * that is which are not finite or exceed a bound in absolute value.
+ * When the budget is exceeded, a std::domain_error is thrown, so
+ * that the proposal is rejected.
+ *
+ * Each evaluation of the right hand side is charged to the budget of
+ * the calling thread (see GetWorkBudget), while a call to Pred is in
+ * progress (see WorkBudgetScope). The limits are off by default
+ * (see the macros TORSTEN_MAX_RHS_EVALUATIONS,
+ * TORSTEN_MAX_PRED_SECONDS and TORSTEN_DIVERGENCE_BOUND).
+ */
+class WorkBudget {
+private:
+  typedef std::chrono::steady_clock clock;
+  static const int clock_period = 64;  // evaluations between clock reads
+
+  long int max_rhs_;  // NOLINT(runtime/int)
+  double max_time_, bound_;
+  long int rhs_;  // NOLINT(runtime/int)
+  clock::time_point start_;
+  int depth_;  // number of open scopes
+
+  template <typename T>
+  void CheckStates(const std::vector<T>& y, const char* name) const {
+    for (size_t k = 0; k < y.size(); k++) {
+      double y_k = unpromote(y[k]);
+      if (!(std::fabs(y_k) <= bound_))
+        stan::math::domain_error("Pred", name, y_k, "is ",
+                                 ", the ODE solution diverges!");
+    }
+  }
+
+public:
+  WorkBudget()
+    : max_rhs_(TORSTEN_MAX_RHS_EVALUATIONS),
+      max_time_(TORSTEN_MAX_PRED_SECONDS),
+      bound_(TORSTEN_DIVERGENCE_BOUND), rhs_(0), depth_(0) {
+    if (bound_ == 0) bound_ = std::numeric_limits<double>::infinity();
+  }
+
+  /**
+   * Sets the maximum number of evaluations of the right hand side
+   * of the ODE in one call to Pred (0: no limit).
+   */
+  void set_max_rhs_evaluations(long int n) {  // NOLINT(runtime/int)
+    if (n < 0)
+      stan::math::invalid_argument("WorkBudget", "maximum number of "
+                                   "evaluations", n, "", " must be "
+                                   "non-negative!");
+    max_rhs_ = n;
+  }
+
+  long int get_max_rhs_evaluations() const { return max_rhs_; }  // NOLINT
+
+  /**
+   * Sets the maximum wall time, in seconds, of one call to Pred
+   * (0: no limit). The clock is read every few evaluations of the
+   * right hand side of the ODE.
+   */
+  void set_max_time(double seconds) {
+    if (!(seconds >= 0))
+      stan::math::invalid_argument("WorkBudget", "maximum time", seconds,
+                                   "", " must be non-negative!");
+    max_time_ = seconds;
+  }
+
+  double get_max_time() const { return max_time_; }
+
+  /**
+   * Sets the bound on the absolute value of the states and of their
+   * derivatives passed to and returned by the right hand side of the
+   * ODE (0: no bound). As soon as any limit of the budget is set,
+   * the states which are not finite are rejected.
+   */
+  void set_divergence_bound(double bound) {
+    if (!(bound >= 0))
+      stan::math::invalid_argument("WorkBudget", "divergence bound", bound,
+                                   "", " must be non-negative!");
+    bound_ = (bound == 0) ? std::numeric_limits<double>::infinity() : bound;
+  }
+
+  double get_divergence_bound() const {
+    return std::isinf(bound_) ? 0 : bound_;
+  }
+
+  /**
+   * Returns the number of evaluations of the right hand side of
+   * the ODE in the current (or last) call to Pred.
+   */
+  long int get_rhs_evaluations() const { return rhs_; }  // NOLINT
+
+  /**
+   * Starts the budget of a call, unless a call is already in
+   * progress on the thread.
+   */
+  void Open() {
+    if (depth_++ > 0) return;
+    rhs_ = 0;
+    if (max_time_ > 0) start_ = clock::now();
+  }
+
+  void Close() { depth_--; }
+
+  /**
+   * Charges one evaluation of the right hand side of the ODE, at
+   * states y with derivatives dydt, to the budget.
+   */
+  template <typename T1, typename T2>
+  void Charge(const std::vector<T1>& y, const std::vector<T2>& dydt) {
+    if (depth_ == 0) return;
+    rhs_++;
+    if (max_rhs_ > 0 && rhs_ > max_rhs_)
+      stan::math::domain_error("Pred", "number of evaluations of the ODE",
+                               rhs_, "is ", ", over the work budget!");
+    if (max_time_ > 0 && rhs_ % clock_period == 0) {
+      double seconds
+        = std::chrono::duration<double>(clock::now() - start_).count();
+      if (seconds > max_time_)
+        stan::math::domain_error("Pred", "wall time (s)", seconds, "is ",
+                                 ", over the work budget!");
+    }
+    if (!std::isinf(bound_) || max_rhs_ > 0 || max_time_ > 0) {
+      CheckStates(y, "state");
+      CheckStates(dydt, "derivative of the state");
+    }
+  }
+};
+
+/**
+ * Returns the work budget of the calling thread.
+ */
+inline WorkBudget& GetWorkBudget() {
+  static thread_local WorkBudget budget;
+  return budget;
+}
+
+/**
+ * Opens the work budget of the thread for the duration of a call
+ * to Pred.
+ */
+class WorkBudgetScope {
+private:
+  WorkBudgetScope(const WorkBudgetScope&);
+  WorkBudgetScope& operator=(const WorkBudgetScope&);
+
+public:
+  WorkBudgetScope() { GetWorkBudget().Open(); }
+  ~WorkBudgetScope() { GetWorkBudget().Close(); }
+};
+
+}
+
+#endif
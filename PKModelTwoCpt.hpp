@@ -35,6 +35,9 @@ namespace torsten {
  * @param[in] cmt compartment number at each event
  * @param[in] addl additional dosing at each event
  * @param[in] ss steady state approximation at each event (0: no, 1: yes)
+ * @param[in] auc_cmt compartments (starting at 1) whose AUC since
+ *            the first or last reset event is returned after the
+ *            amounts, in as many extra columns.
  * @return a matrix with predicted amount in each compartment
  *         at each event.
  */
@@ -53,7 +56,8 @@ PKModelTwoCpt(const std::vector<T0>& time,
               const std::vector<int>& ss,
               const std::vector<std::vector<T4> >& pMatrix,
               const std::vector<std::vector<T5> >& biovar,
-              const std::vector<std::vector<T6> >& tlag) {
+              const std::vector<std::vector<T6> >& tlag,
+              const std::vector<int>& auc_cmt = std::vector<int>()) {
   using std::vector;
   using Eigen::Dynamic;
   using Eigen::Matrix;
@@ -63,46 +67,36 @@ PKModelTwoCpt(const std::vector<T0>& time,
   int nCmt = 3;
   int nParms = 5;
   static const char* function("PKModelTwoCpt");
+  TORSTEN_TAPE_SCOPE(function);
 
   // Check arguments
   torsten::pmetricsCheck(time, amt, rate, ii, evid, cmt, addl, ss,
                 pMatrix, biovar, tlag, function);
-  for (size_t i = 0; i < pMatrix.size(); i++) {
-    check_positive_finite(function, "PK parameter CL", pMatrix[i][0]);
-    check_positive_finite(function, "PK parameter Q", pMatrix[i][1]);
-    check_positive_finite(function, "PK parameter V2", pMatrix[i][2]);
-    check_positive_finite(function, "PK parameter V3", pMatrix[i][3]);
-  }
-  std::string message4 = ", but must equal the number of parameters in the model: " // NOLINT
-    + boost::lexical_cast<std::string>(nParms) + "!";
-  const char* length_error4 = message4.c_str();
-  if (!(pMatrix[0].size() == (size_t) nParms))
-    stan::math::invalid_argument(function,
-    "The number of parameters per event (length of a vector in the first argument) is", // NOLINT
-    pMatrix[0].size(), "", length_error4);
-
   // FIX ME - we want to check every array of pMatrix, not
   // just the first one (at index 0)
-  std::string message5 = ", but must equal the number of parameters in the model: " // NOLINT
-  + boost::lexical_cast<std::string>(nParms) + "!";
-  const char* length_error5 = message5.c_str();
+  static const char* length_error4 = ", but must equal the number of parameters in the model: ";  // NOLINT
   if (!(pMatrix[0].size() == (size_t) nParms))
-    stan::math::invalid_argument(function,
-    "The number of parameters per event (length of a vector in the ninth argument) is", // NOLINT
-    pMatrix[0].size(), "", length_error5);
+    length_error(function,
+    "The number of parameters per event (length of a vector in the first argument) is", // NOLINT
+    pMatrix[0].size(), length_error4, nParms);
 
-  std::string message6 = ", but must equal the number of compartments in the model: " // NOLINT
-  + boost::lexical_cast<std::string>(nCmt) + "!";
-  const char* length_error6 = message6.c_str();
+  static const char* length_error5 = ", but must equal the number of compartments in the model: ";  // NOLINT
   if (!(biovar[0].size() == (size_t) nCmt))
-    stan::math::invalid_argument(function,
+    length_error(function,
     "The number of biovariability parameters per event (length of a vector in the tenth argument) is", // NOLINT
-    biovar[0].size(), "", length_error6);
+    biovar[0].size(), length_error5, nCmt);
 
   if (!(tlag[0].size() == (size_t) nCmt))
-    stan::math::invalid_argument(function,
+    length_error(function,
     "The number of lag times parameters per event (length of a vector in the eleventh argument) is", // NOLINT
-    tlag[0].size(), "", length_error5);
+    tlag[0].size(), length_error5, nCmt);
+
+  for (size_t i = 0; i < pMatrix.size(); i++) {
+    check_positive_finite(function, "PK parameter CL", pMatrix[i][0]);
+    check_positive_finite(function, "PK parameter Q", pMatrix[i][1]);
+    check_positive_finite(function, "PK parameter V2", pMatrix[i][2]);
+    check_positive_finite(function, "PK parameter V3", pMatrix[i][3]);
+  }
 
   // Construct dummy matrix for last argument of pred
   Matrix<T4, Dynamic, Dynamic> dummy_system;
@@ -112,7 +106,7 @@ PKModelTwoCpt(const std::vector<T0>& time,
   return Pred(time, amt, rate, ii, evid, cmt, addl, ss,
               pMatrix, biovar, tlag,
               nCmt, dummy_systems,
-              Pred1_twoCpt(), PredSS_twoCpt());
+              Pred1_twoCpt(), PredSS_twoCpt(), auc_cmt);
 }
 
 /**
@@ -299,5 +293,84 @@ PKModelTwoCpt(const std::vector<T0>& time,
                        pMatrix, biovar, vec_tlag);
 }
 
+/**
+ * Overload function for an event schedule compiled beforehand
+ * (see EventSchedule), with nCmt = 3. The book-keeping of the event
+ * schedule is skipped, which saves time when the same schedule is
+ * used for many evaluations of the model.
+ *
+ * @tparam T4 type of scalars for the model parameters.
+ * @tparam T5 type of scalar for bio-variability F.
+ * @param[in] schedule compiled event schedule
+ * @param[in] pMatrix parameters at each event
+ * @param[in] biovar bio-variability at each event
+ * @param[in] sink if not null, receives the predictions at each
+ *            kept event, which are then not returned (see PredSink)
+ * @param[in] auc_cmt compartments (starting at 1) whose AUC is
+ *            returned after the amounts.
+ * @return a matrix with predicted amount in each compartment
+ *         at each event.
+ */
+template <typename T4, typename T5>
+Eigen::Matrix <typename boost::math::tools::promote_args<T4, T5>::type,
+  Eigen::Dynamic, Eigen::Dynamic>
+PKModelTwoCpt(const EventSchedule& schedule,
+              const std::vector<std::vector<T4> >& pMatrix,
+              const std::vector<std::vector<T5> >& biovar,
+              PredSink* sink = 0,
+              const std::vector<int>& auc_cmt = std::vector<int>()) {
+  using stan::math::check_positive_finite;
+  using stan::math::invalid_argument;
+
+  int nCmt = 3;
+  int nParm = 5;
+
+  static const char* function("PKModelTwoCpt");
+  TORSTEN_TAPE_SCOPE(function);
+  schedule.CheckParameters(function, nCmt, pMatrix.size(), biovar.size());
+  for (size_t i = 0; i < pMatrix.size(); i++) {
+    if (pMatrix[i].size() != (size_t) nParm)
+      invalid_argument(function, "The number of parameters per event is",
+                       pMatrix[i].size(), "",
+                       ", but must equal the number of parameters in the model!");  // NOLINT
+    check_positive_finite(function, "PK parameter CL", pMatrix[i][0]);
+    check_positive_finite(function, "PK parameter Q", pMatrix[i][1]);
+    check_positive_finite(function, "PK parameter V2", pMatrix[i][2]);
+    check_positive_finite(function, "PK parameter V3", pMatrix[i][3]);
+  }
+  for (size_t i = 0; i < biovar.size(); i++)
+    if (biovar[i].size() != (size_t) nCmt)
+      invalid_argument(function,
+                       "The number of biovariability parameters per event is",
+                       biovar[i].size(), "",
+                       ", but must equal the number of compartments in the model!");  // NOLINT
+
+  // Construct dummy matrix for last argument of pred
+  Eigen::Matrix<T4, Eigen::Dynamic, Eigen::Dynamic> dummy_system;
+  std::vector<Eigen::Matrix<T4, Eigen::Dynamic, Eigen::Dynamic> >
+    dummy_systems(1, dummy_system);
+
+  return Pred(schedule, pMatrix, biovar, nCmt, dummy_systems,
+              Pred1_twoCpt(), PredSS_twoCpt(), sink, auc_cmt);
+}
+
+/**
+ * Overload function for a compiled event schedule, with
+ * std::vector for pMatrix and biovar.
+ */
+template <typename T4, typename T5>
+Eigen::Matrix <typename boost::math::tools::promote_args<T4, T5>::type,
+  Eigen::Dynamic, Eigen::Dynamic>
+PKModelTwoCpt(const EventSchedule& schedule,
+              const std::vector<T4>& pMatrix,
+              const std::vector<T5>& biovar,
+              PredSink* sink = 0,
+              const std::vector<int>& auc_cmt = std::vector<int>()) {
+  std::vector<std::vector<T4> > vec_pMatrix(1, pMatrix);
+  std::vector<std::vector<T5> > vec_biovar(1, biovar);
+
+  return PKModelTwoCpt(schedule, vec_pMatrix, vec_biovar, sink, auc_cmt);
+}
+
 }
 #endif
@@ -0,0 +1,151 @@
+/**
+ * Gradients of the checkpointed sweep over a compiled event
+ * schedule (see PredCheckpoint).
+ *
+ * Runs PKModelOneCpt and generalOdeModel_rk45 (oneCptODE) on a long
+ * synthetic event schedule compiled into an EventSchedule, with the
+ * whole tape kept (checkpoint interval 0), with a checkpoint at
+ * every event (1), and with the default interval, the square root
+ * of the number of events (-1). The gradients of the sum of the
+ * predictions with respect to the parameters must agree up to
+ * round-off: the checkpointed reverse pass recomputes the same
+ * operations on nested tapes.
+ *
+ * Writes one CSV row per model and interval with the maximal
+ * relative difference of the gradient to that of the plain sweep,
+ * and exits with status 1 if it exceeds --max-error.
+ *
+ * Options (all optional):
+ *   --design=bolus (see MakeSyntheticSchedule)
+ *   --size=2000             number of rows in the event schedule
+ *   --auc                   also return the AUC of the central
+ *                           compartment
+ *   --max-error=1e-12
+ *   --output=file           write the results to file instead of stdout
+ */
+#include <stan/math/rev/mat.hpp>
+#include <stan/math/torsten/torsten.hpp>
+#include <stan/math/torsten/benchmark/synthetic_schedule.hpp>
+#include <stan/math/torsten/benchmark/ode_systems.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using torsten::benchmark::SyntheticSchedule;
+using torsten::benchmark::MakeSyntheticSchedule;
+using torsten::benchmark::oneCptODE;
+
+std::vector<double> Theta() {
+  double p[] = {10, 80, 1.2};
+  return std::vector<double>(p, p + 3);
+}
+
+/**
+ * Gradient of the sum of the predictions with respect to theta.
+ */
+std::vector<double> Gradient(const std::string& model,
+                             const torsten::EventSchedule& schedule,
+                             const std::vector<int>& auc_cmt) {
+  using stan::math::var;
+  std::vector<double> theta_dbl = Theta(), biovar(2, 1), gradient;
+  try {
+    std::vector<var> theta(theta_dbl.begin(), theta_dbl.end());
+    Eigen::Matrix<var, Eigen::Dynamic, Eigen::Dynamic> pred;
+    if (model == "generalOdeModel_rk45")
+      pred = torsten::generalOdeModel_rk45(oneCptODE(), 2, schedule, theta,
+                                           biovar, 0, 1e-8, 1e-8, 1e8, 0,
+                                           auc_cmt);
+    else
+      pred = torsten::PKModelOneCpt(schedule, theta, biovar, 0, auc_cmt);
+    var total = 0;
+    for (int i = 0; i < pred.size(); i++) total += pred(i);
+    total.grad();
+    for (size_t i = 0; i < theta.size(); i++)
+      gradient.push_back(theta[i].adj());
+  } catch (...) {
+    stan::math::recover_memory();
+    throw;
+  }
+  stan::math::recover_memory();
+  return gradient;
+}
+
+double MaxError(const std::vector<double>& x,
+                const std::vector<double>& ref) {
+  double error = 0;
+  for (size_t i = 0; i < ref.size(); i++)
+    error = std::max(error, std::fabs(x[i] - ref[i])
+                              / std::max(std::fabs(ref[i]), 1e-300));
+  return error;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  std::string design = "bolus", output;
+  int size = 2000;
+  double maxError = 1e-12;
+  std::vector<int> auc_cmt;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg(argv[i]);
+    size_t eq = arg.find('=');
+    std::string key = arg.substr(0, eq),
+      value = (eq == std::string::npos) ? "" : arg.substr(eq + 1);
+    if (key == "--design") {
+      design = value;
+    } else if (key == "--size") {
+      size = std::atoi(value.c_str());
+    } else if (key == "--auc") {
+      auc_cmt.assign(1, 2);
+    } else if (key == "--max-error") {
+      maxError = std::atof(value.c_str());
+    } else if (key == "--output") {
+      output = value;
+    } else {
+      std::cerr << "unknown option: " << arg << std::endl;
+      return 1;
+    }
+  }
+
+  std::ofstream file;
+  if (!output.empty()) file.open(output.c_str());
+  std::ostream& out = output.empty() ? std::cout : file;
+
+  const char* models[] = {"PKModelOneCpt", "generalOdeModel_rk45"};
+  const int intervals[] = {1, -1};
+  bool ok = true;
+  out << "model,design,n_events,checkpoint_interval,gradient_error"
+      << std::endl;
+  try {
+    SyntheticSchedule s = MakeSyntheticSchedule(design, size, 1, 2);
+    std::vector<double> tlag(2, 0);
+    tlag[0] = s.tlag;
+    torsten::EventSchedule schedule(s.time, s.amt, s.rate, s.ii, s.evid,
+                                    s.cmt, s.addl, s.ss, tlag, 2);
+    for (int m = 0; m < 2; m++) {
+      schedule.set_checkpoint_interval(0);
+      std::vector<double> ref = Gradient(models[m], schedule, auc_cmt);
+      for (int k = 0; k < 2; k++) {
+        schedule.set_checkpoint_interval(intervals[k]);
+        double error = MaxError(Gradient(models[m], schedule, auc_cmt),
+                                ref);
+        if (!(error <= maxError)) ok = false;
+        out << models[m] << "," << design << "," << s.size() << ","
+            << intervals[k] << "," << error << std::endl;
+      }
+    }
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,133 @@
+/**
+ * Integrator calls saved by the time tolerance of the EventSchedule
+ * constructor (see EventSchedule::Cursor::get_interval).
+ *
+ * Compiles a synthetic event schedule (by default the jitter design,
+ * in which each dose is followed by a sample a few seconds later)
+ * with a time tolerance of 0 and with each of the given tolerances,
+ * and runs generalOdeModel_rk45 (oneCptODE) on each compiled
+ * schedule. The calls of the ODE integrator are counted with the
+ * profile of Torsten (TORSTEN_PROFILE is defined here).
+ *
+ * Writes one CSV row per tolerance with the number of integrator
+ * calls per model call, the time per call, and the maximal
+ * difference of the predictions to those with tolerance 0, relative
+ * to the largest prediction: skipping the short intervals is an
+ * approximation.
+ *
+ * Options (all optional):
+ *   --design=jitter (see MakeSyntheticSchedule)
+ *   --size=1000             number of rows in the event schedule
+ *   --tolerances=0.01       time tolerances, in the time units of
+ *                           the schedule
+ *   --min-time=0.2          minimum time (in seconds) spent on each case
+ *   --output=file           write the results to file instead of stdout
+ */
+#define TORSTEN_PROFILE
+#include <stan/math/rev/mat.hpp>
+#include <stan/math/torsten/torsten.hpp>
+#include <stan/math/torsten/benchmark/synthetic_schedule.hpp>
+#include <stan/math/torsten/benchmark/ode_systems.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using torsten::benchmark::SyntheticSchedule;
+using torsten::benchmark::MakeSyntheticSchedule;
+using torsten::benchmark::oneCptODE;
+
+Eigen::MatrixXd Run(const torsten::EventSchedule& schedule) {
+  double p[] = {10, 80, 1.2};
+  std::vector<double> theta(p, p + 3), biovar(2, 1);
+  return torsten::generalOdeModel_rk45(oneCptODE(), 2, schedule, theta,
+                                       biovar);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  std::string design = "jitter", output;
+  int size = 1000;
+  double minTime = 0.2;
+  std::vector<double> tolerances;
+  tolerances.push_back(0.01);
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg(argv[i]);
+    size_t eq = arg.find('=');
+    std::string key = arg.substr(0, eq),
+      value = (eq == std::string::npos) ? "" : arg.substr(eq + 1);
+    if (key == "--design") {
+      design = value;
+    } else if (key == "--size") {
+      size = std::atoi(value.c_str());
+    } else if (key == "--tolerances") {
+      tolerances.clear();
+      std::stringstream stream(value);
+      std::string item;
+      while (std::getline(stream, item, ','))
+        if (!item.empty()) tolerances.push_back(std::atof(item.c_str()));
+    } else if (key == "--min-time") {
+      minTime = std::atof(value.c_str());
+    } else if (key == "--output") {
+      output = value;
+    } else {
+      std::cerr << "unknown option: " << arg << std::endl;
+      return 1;
+    }
+  }
+  tolerances.insert(tolerances.begin(), 0);
+
+  std::ofstream file;
+  if (!output.empty()) file.open(output.c_str());
+  std::ostream& out = output.empty() ? std::cout : file;
+
+  out << "design,n_events,time_tolerance,integrator_calls,"
+      << "seconds_per_call,pred_error" << std::endl;
+  try {
+    SyntheticSchedule s = MakeSyntheticSchedule(design, size, 1, 2);
+    std::vector<double> tlag(2, 0);
+    tlag[0] = s.tlag;
+    Eigen::MatrixXd ref;
+    for (size_t k = 0; k < tolerances.size(); k++) {
+      torsten::EventSchedule schedule(s.time, s.amt, s.rate, s.ii, s.evid,
+                                      s.cmt, s.addl, s.ss, tlag, 2, 1, 1, 1,
+                                      tolerances[k]);
+      torsten::GetProfile().Reset();
+      Eigen::MatrixXd pred = Run(schedule);
+      long int calls;  // NOLINT(runtime/int)
+      calls = torsten::GetProfile().get_count("integrator::rk45");
+      if (k == 0) ref = pred;
+      double error = (pred - ref).cwiseAbs().maxCoeff()
+        / std::max(ref.cwiseAbs().maxCoeff(), 1e-300);
+
+      typedef std::chrono::steady_clock clock;
+      double elapsed = 0;
+      int reps = 0;
+      clock::time_point start = clock::now();
+      do {
+        Run(schedule);
+        reps++;
+        elapsed = std::chrono::duration<double>(clock::now() - start)
+          .count();
+      } while (elapsed < minTime);
+
+      out << design << "," << s.size() << "," << tolerances[k] << ","
+          << calls << "," << elapsed / reps << "," << error << std::endl;
+    }
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
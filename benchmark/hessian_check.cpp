@@ -0,0 +1,233 @@
+/**
+ * Second derivatives of the analytical models with forward mode
+ * over reverse mode autodiff (stan::math::fvar<var>).
+ *
+ * Runs PKModelOneCpt, PKModelTwoCpt and linOdeModel on a synthetic
+ * event schedule, given either as the data columns ("data") or
+ * compiled into an EventSchedule ("schedule"). The Hessian of the
+ * sum of the predictions with respect to the parameters is computed
+ * one row at a time, seeding the tangent of one parameter and taking
+ * the gradient of the tangent of the sum, and compared with central
+ * finite differences of the reverse mode gradient.
+ *
+ * Writes one CSV row per model and overload with the maximal
+ * relative difference of the Hessian to the finite differences, and
+ * exits with status 1 if it exceeds --max-error.
+ *
+ * Options (all optional):
+ *   --design=bolus (see MakeSyntheticSchedule)
+ *   --size=24               number of rows in the event schedule
+ *   --step=1e-5             relative step of the finite differences
+ *   --max-error=1e-5
+ *   --output=file           write the results to file instead of stdout
+ */
+#include <stan/math/mix/mat.hpp>
+#include <stan/math/torsten/torsten.hpp>
+#include <stan/math/torsten/benchmark/synthetic_schedule.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using torsten::benchmark::SyntheticSchedule;
+using torsten::benchmark::MakeSyntheticSchedule;
+
+struct Setting {
+  std::string model;
+  bool schedule;  // compiled into an EventSchedule
+};
+
+int NCmt(const std::string& model) {
+  return model == "PKModelTwoCpt" ? 3 : 2;
+}
+
+std::vector<double> Theta(const std::string& model) {
+  std::vector<double> theta;
+  if (model == "PKModelTwoCpt") {
+    double p[] = {5, 8, 35, 105, 1.2};
+    theta.assign(p, p + 5);
+  } else {
+    double p[] = {10, 80, 1.2};
+    theta.assign(p, p + 3);
+  }
+  return theta;
+}
+
+template <typename T>
+Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>
+Run(const Setting& c, const SyntheticSchedule& s,
+    const torsten::EventSchedule& schedule, const std::vector<T>& theta) {
+  int nCmt = NCmt(c.model);
+  std::vector<double> biovar(nCmt, 1), tlag(nCmt, 0);
+  tlag[0] = s.tlag;
+
+  if (c.model == "linOdeModel") {
+    Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic> K(2, 2);
+    K(0, 0) = -theta[2];
+    K(0, 1) = 0;
+    K(1, 0) = theta[2];
+    K(1, 1) = -theta[0] / theta[1];
+    if (c.schedule)
+      return torsten::linOdeModel(schedule, K, biovar);
+    return torsten::linOdeModel(s.time, s.amt, s.rate, s.ii, s.evid, s.cmt,
+                                s.addl, s.ss, K, biovar, tlag);
+  }
+  if (c.model == "PKModelTwoCpt") {
+    if (c.schedule)
+      return torsten::PKModelTwoCpt(schedule, theta, biovar);
+    return torsten::PKModelTwoCpt(s.time, s.amt, s.rate, s.ii, s.evid,
+                                  s.cmt, s.addl, s.ss, theta, biovar, tlag);
+  }
+  if (c.schedule)
+    return torsten::PKModelOneCpt(schedule, theta, biovar);
+  return torsten::PKModelOneCpt(s.time, s.amt, s.rate, s.ii, s.evid, s.cmt,
+                                s.addl, s.ss, theta, biovar, tlag);
+}
+
+/**
+ * Gradient of the sum of the predictions with respect to theta.
+ */
+std::vector<double> Gradient(const Setting& c, const SyntheticSchedule& s,
+                             const torsten::EventSchedule& schedule,
+                             const std::vector<double>& theta_dbl) {
+  using stan::math::var;
+  std::vector<double> gradient;
+  try {
+    std::vector<var> theta(theta_dbl.begin(), theta_dbl.end());
+    Eigen::Matrix<var, Eigen::Dynamic, Eigen::Dynamic>
+      pred = Run(c, s, schedule, theta);
+    var total = 0;
+    for (int i = 0; i < pred.size(); i++) total += pred(i);
+    total.grad();
+    for (size_t i = 0; i < theta.size(); i++)
+      gradient.push_back(theta[i].adj());
+  } catch (...) {
+    stan::math::recover_memory();
+    throw;
+  }
+  stan::math::recover_memory();
+  return gradient;
+}
+
+/**
+ * Hessian of the sum of the predictions with respect to theta,
+ * row j being the gradient of the derivative in the direction of
+ * theta[j].
+ */
+std::vector<std::vector<double> >
+Hessian(const Setting& c, const SyntheticSchedule& s,
+        const torsten::EventSchedule& schedule,
+        const std::vector<double>& theta_dbl) {
+  using stan::math::fvar;
+  using stan::math::var;
+  size_t n = theta_dbl.size();
+  std::vector<std::vector<double> > hessian(n);
+  for (size_t j = 0; j < n; j++) {
+    try {
+      std::vector<var> theta(theta_dbl.begin(), theta_dbl.end());
+      std::vector<fvar<var> > x;
+      for (size_t i = 0; i < n; i++)
+        x.push_back(fvar<var>(theta[i], i == j ? 1.0 : 0.0));
+      Eigen::Matrix<fvar<var>, Eigen::Dynamic, Eigen::Dynamic>
+        pred = Run(c, s, schedule, x);
+      fvar<var> total = 0;
+      for (int i = 0; i < pred.size(); i++) total += pred(i);
+      total.d_.grad();
+      for (size_t i = 0; i < n; i++)
+        hessian[j].push_back(theta[i].adj());
+    } catch (...) {
+      stan::math::recover_memory();
+      throw;
+    }
+    stan::math::recover_memory();
+  }
+  return hessian;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  std::string design = "bolus", output;
+  int size = 24;
+  double step = 1e-5, maxError = 1e-5;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg(argv[i]);
+    size_t eq = arg.find('=');
+    std::string key = arg.substr(0, eq),
+      value = (eq == std::string::npos) ? "" : arg.substr(eq + 1);
+    if (key == "--design") {
+      design = value;
+    } else if (key == "--size") {
+      size = std::atoi(value.c_str());
+    } else if (key == "--step") {
+      step = std::atof(value.c_str());
+    } else if (key == "--max-error") {
+      maxError = std::atof(value.c_str());
+    } else if (key == "--output") {
+      output = value;
+    } else {
+      std::cerr << "unknown option: " << arg << std::endl;
+      return 1;
+    }
+  }
+
+  std::ofstream file;
+  if (!output.empty()) file.open(output.c_str());
+  std::ostream& out = output.empty() ? std::cout : file;
+
+  const char* models[] = {"PKModelOneCpt", "PKModelTwoCpt", "linOdeModel"};
+  bool ok = true;
+  out << "model,overload,design,hessian_error" << std::endl;
+  try {
+    for (int m = 0; m < 3; m++) {
+      int nCmt = NCmt(models[m]);
+      SyntheticSchedule s = MakeSyntheticSchedule(design, size, 1, 2);
+      std::vector<double> tlag(nCmt, 0);
+      tlag[0] = s.tlag;
+      torsten::EventSchedule schedule(s.time, s.amt, s.rate, s.ii, s.evid,
+                                      s.cmt, s.addl, s.ss, tlag, nCmt);
+      std::vector<double> theta = Theta(models[m]);
+      for (int k = 0; k < 2; k++) {
+        Setting c;
+        c.model = models[m];
+        c.schedule = (k == 1);
+        std::vector<std::vector<double> >
+          hessian = Hessian(c, s, schedule, theta);
+
+        // the Hessian is compared row by row, relative to the largest
+        // entry of the row.
+        double error = 0;
+        for (size_t j = 0; j < theta.size(); j++) {
+          double h = step * std::fabs(theta[j]);
+          std::vector<double> plus = theta, minus = theta;
+          plus[j] += h;
+          minus[j] -= h;
+          std::vector<double> g_plus = Gradient(c, s, schedule, plus),
+            g_minus = Gradient(c, s, schedule, minus);
+          double scale = 1e-300;
+          for (size_t i = 0; i < theta.size(); i++)
+            scale = std::max(scale, std::fabs(hessian[j][i]));
+          for (size_t i = 0; i < theta.size(); i++) {
+            double fd = (g_plus[i] - g_minus[i]) / (2 * h);
+            error = std::max(error, std::fabs(hessian[j][i] - fd) / scale);
+          }
+        }
+        if (!(error <= maxError)) ok = false;
+        out << models[m] << "," << (c.schedule ? "schedule" : "data") << ","
+            << design << "," << error << std::endl;
+      }
+    }
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,158 @@
+/**
+ * Benchmark for the univariate integral functions.
+ *
+ * Times univariate_integral_rk45, univariate_integral_bdf and
+ * univariate_integral_quad on a smooth integrand (a biexponential
+ * concentration profile), for each combination of data and
+ * parameters among theta and the integral limits:
+ *    double      theta and limits are data
+ *    var_theta   theta are parameters, limits are data
+ *    var_limits  theta are data, limits are parameters
+ *    var_all     theta and limits are parameters
+ * Cases with parameters include the gradient evaluation.
+ *
+ * Options (all optional):
+ *   --methods=rk45,bdf,quad
+ *   --cases=double,var_theta,var_limits,var_all
+ *   --min-time=0.2  minimum time (in seconds) spent on each case
+ *   --output=file   write the results to file instead of stdout
+ */
+#include <stan/math/rev/mat.hpp>
+#include <stan/math/torsten/torsten.hpp>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using stan::math::var;
+
+/**
+ * Biexponential profile, a * exp(-alpha * t) + b * exp(-beta * t).
+ */
+struct biexponential {
+  template <typename T0, typename T1>
+  typename boost::math::tools::promote_args<T0, T1>::type
+  operator()(const T0& t, const std::vector<T1>& theta,
+             const std::vector<double>& x_r, const std::vector<int>& x_i,
+             std::ostream* msgs) const {
+    return theta[0] * exp(-theta[1] * t) + theta[2] * exp(-theta[3] * t);
+  }
+};
+
+std::vector<double> Theta() {
+  double theta[] = {5, 1.5, 2, 0.1};
+  return std::vector<double>(theta, theta + 4);
+}
+
+const double t0 = 0.5, t1 = 24;
+
+template <typename T0, typename Tl, typename Tr>
+typename stan::return_type<Tl, Tr, T0>::type
+Integral(const std::string& method, const std::vector<T0>& theta,
+         const Tl& a, const Tr& b) {
+  std::vector<double> x_r;
+  std::vector<int> x_i;
+  if (method == "bdf")
+    return stan::math::univariate_integral_bdf(biexponential(), a, b, theta,
+                                               x_r, x_i);
+  if (method == "quad")
+    return stan::math::univariate_integral_quad(biexponential(), a, b, theta,
+                                                x_r, x_i);
+  return stan::math::univariate_integral_rk45(biexponential(), a, b, theta,
+                                              x_r, x_i);
+}
+
+/**
+ * Computes the integral (and its gradient) once, and returns its
+ * value.
+ */
+double Call(const std::string& method, const std::string& scalar) {
+  std::vector<double> theta = Theta();
+  if (scalar == "double") return Integral(method, theta, t0, t1);
+
+  double value;
+  try {
+    std::vector<var> theta_v(theta.begin(), theta.end());
+    var a = t0, b = t1, integral;
+    if (scalar == "var_theta")
+      integral = Integral(method, theta_v, t0, t1);
+    else if (scalar == "var_limits")
+      integral = Integral(method, theta, a, b);
+    else
+      integral = Integral(method, theta_v, a, b);
+    integral.grad();
+    value = integral.val();
+  } catch (...) {
+    stan::math::recover_memory();
+    throw;
+  }
+  stan::math::recover_memory();
+  return value;
+}
+
+std::vector<std::string> Split(const std::string& str) {
+  std::vector<std::string> items;
+  std::stringstream stream(str);
+  std::string item;
+  while (std::getline(stream, item, ','))
+    if (!item.empty()) items.push_back(item);
+  return items;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  std::vector<std::string> methods = Split("rk45,bdf,quad");
+  std::vector<std::string> cases
+    = Split("double,var_theta,var_limits,var_all");
+  double minTime = 0.2;
+  std::string output;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg(argv[i]);
+    size_t eq = arg.find('=');
+    std::string key = arg.substr(0, eq),
+      value = (eq == std::string::npos) ? "" : arg.substr(eq + 1);
+    if (key == "--methods") {
+      methods = Split(value);
+    } else if (key == "--cases") {
+      cases = Split(value);
+    } else if (key == "--min-time") {
+      minTime = std::atof(value.c_str());
+    } else if (key == "--output") {
+      output = value;
+    } else {
+      std::cerr << "unknown option: " << arg << std::endl;
+      return 1;
+    }
+  }
+
+  std::ofstream file;
+  if (!output.empty()) file.open(output.c_str());
+  std::ostream& out = output.empty() ? std::cout : file;
+  out.precision(10);
+
+  out << "method,scalar,reps,seconds_per_call,integral" << std::endl;
+  for (size_t i = 0; i < methods.size(); i++) {
+    for (size_t j = 0; j < cases.size(); j++) {
+      typedef std::chrono::steady_clock clock;
+      int reps = 0;
+      double elapsed = 0, integral = 0;
+      clock::time_point start = clock::now();
+      do {
+        integral = Call(methods[i], cases[j]);
+        reps++;
+        elapsed = std::chrono::duration<double>(clock::now() - start).count();
+      } while (elapsed < minTime);
+      out << methods[i] << "," << cases[j] << "," << reps << ","
+          << elapsed / reps << "," << integral << std::endl;
+    }
+  }
+
+  return 0;
+}
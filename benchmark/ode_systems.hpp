@@ -0,0 +1,120 @@
+#ifndef STAN_MATH_TORSTEN_BENCHMARK_ODE_SYSTEMS_HPP
+#define STAN_MATH_TORSTEN_BENCHMARK_ODE_SYSTEMS_HPP
+
+#include <boost/math/tools/promotion.hpp>
+#include <iostream>
+#include <vector>
+
+namespace torsten {
+namespace benchmark {
+
+/**
+ * One compartment model with first order absorption, written
+ * as a system of ODEs. theta = {CL, V, ka}.
+ */
+struct oneCptODE {
+  template <typename T0, typename T1, typename T2, typename T3>
+  std::vector<typename boost::math::tools::promote_args<T0, T1, T2,
+    T3>::type>
+  operator()(const T0& t,
+             const std::vector<T1>& y,
+             const std::vector<T2>& theta,
+             const std::vector<T3>& x_r,
+             const std::vector<int>& x_i,
+             std::ostream* pstream_) const {
+    typedef typename boost::math::tools::promote_args<T0, T1, T2, T3>::type
+      scalar;
+    std::vector<scalar> dydt(2);
+    dydt[0] = -theta[2] * y[0];
+    dydt[1] = theta[2] * y[0] - theta[0] / theta[1] * y[1];
+    return dydt;
+  }
+};
+
+/**
+ * Effect compartment driven by the analytical PK solution of
+ * the mixed solver. The central compartment is the second PK
+ * state for both the one and the two compartment base models, and
+ * the last element of theta is ke0.
+ */
+struct effectCptODE {
+  template <typename T0, typename T1, typename T2, typename T3,
+            typename T4>
+  std::vector<typename boost::math::tools::promote_args<T0, T1, T2, T3,
+    T4>::type>
+  operator()(const T0& t,
+             const std::vector<T1>& y,
+             const std::vector<T2>& y_pk,
+             const std::vector<T3>& theta,
+             const std::vector<T4>& x_r,
+             const std::vector<int>& x_i,
+             std::ostream* pstream_) const {
+    typedef typename boost::math::tools::promote_args<T0, T1, T2, T3,
+      T4>::type scalar;
+    // theta = {CL, V, ka, ke0} or {CL, Q, V2, V3, ka, ke0}
+    size_t nParm = (y_pk.size() == 2) ? 4 : 6;
+    T3 V = (y_pk.size() == 2) ? theta[1] : theta[2];
+    std::vector<scalar> dydt(1);
+    dydt[0] = theta[nParm - 1] * (y_pk[1] / V - y[0]);
+    return dydt;
+  }
+};
+
+/**
+ * One compartment model with first order absorption and an effect
+ * compartment, written as a system of ODEs: the full system of
+ * mixOde1CptModel with effectCptODE. theta = {CL, V, ka, ke0}.
+ */
+struct oneCptEffectODE {
+  template <typename T0, typename T1, typename T2, typename T3>
+  std::vector<typename boost::math::tools::promote_args<T0, T1, T2,
+    T3>::type>
+  operator()(const T0& t,
+             const std::vector<T1>& y,
+             const std::vector<T2>& theta,
+             const std::vector<T3>& x_r,
+             const std::vector<int>& x_i,
+             std::ostream* pstream_) const {
+    typedef typename boost::math::tools::promote_args<T0, T1, T2, T3>::type
+      scalar;
+    std::vector<scalar> dydt(3);
+    dydt[0] = -theta[2] * y[0];
+    dydt[1] = theta[2] * y[0] - theta[0] / theta[1] * y[1];
+    dydt[2] = theta[3] * (y[1] / theta[1] - y[2]);
+    return dydt;
+  }
+};
+
+/**
+ * Two compartment model with first order absorption and an effect
+ * compartment, written as a system of ODEs: the full system of
+ * mixOde2CptModel with effectCptODE.
+ * theta = {CL, Q, V2, V3, ka, ke0}.
+ */
+struct twoCptEffectODE {
+  template <typename T0, typename T1, typename T2, typename T3>
+  std::vector<typename boost::math::tools::promote_args<T0, T1, T2,
+    T3>::type>
+  operator()(const T0& t,
+             const std::vector<T1>& y,
+             const std::vector<T2>& theta,
+             const std::vector<T3>& x_r,
+             const std::vector<int>& x_i,
+             std::ostream* pstream_) const {
+    typedef typename boost::math::tools::promote_args<T0, T1, T2, T3>::type
+      scalar;
+    T2 k10 = theta[0] / theta[2], k12 = theta[1] / theta[2],
+      k21 = theta[1] / theta[3];
+    std::vector<scalar> dydt(4);
+    dydt[0] = -theta[4] * y[0];
+    dydt[1] = theta[4] * y[0] - (k10 + k12) * y[1] + k21 * y[2];
+    dydt[2] = k12 * y[1] - k21 * y[2];
+    dydt[3] = theta[5] * (y[1] / theta[2] - y[3]);
+    return dydt;
+  }
+};
+
+}  // benchmark namespace
+}  // torsten namespace
+
+#endif
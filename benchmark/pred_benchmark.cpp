@@ -0,0 +1,350 @@
+/**
+ * Benchmark for the Torsten model functions.
+ *
+ * Times every model entry point on synthetic NONMEM event schedules
+ * (see synthetic_schedule.hpp), for double parameters and for var
+ * parameters followed by a gradient evaluation. Results are written
+ * as CSV, one row per (model, design, size, scalar type), so that two
+ * runs can be compared line by line.
+ *
+ * Options (all optional):
+ *   --models=PKModelOneCpt,generalOdeModel_bdf,...
+ *   --designs=bolus,infusion,addl,ss1,ss2,lag,reset,jitter
+ *   --sizes=10,100,1000,10000,100000
+ *   --min-time=0.2  minimum time (in seconds) spent on each case
+ *   --output=file   write the results to file instead of stdout
+ */
+#include <stan/math/rev/mat.hpp>
+#include <stan/math/torsten/torsten.hpp>
+#include <stan/math/torsten/benchmark/synthetic_schedule.hpp>
+#include <stan/math/torsten/benchmark/ode_systems.hpp>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using torsten::benchmark::SyntheticSchedule;
+using torsten::benchmark::MakeSyntheticSchedule;
+using torsten::benchmark::SyntheticDesigns;
+using torsten::benchmark::oneCptODE;
+using torsten::benchmark::effectCptODE;
+
+/**
+ * The models are wrapped into structures with a common interface
+ * so that the same driver can time them for any scalar type.
+ */
+struct OneCpt {
+  static std::string Name() { return "PKModelOneCpt"; }
+  static int NCmt() { return 2; }
+  static std::vector<double> Theta() {
+    double theta[] = {10, 80, 1.2};
+    return std::vector<double>(theta, theta + 3);
+  }
+  template <typename T>
+  Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>
+  operator()(const SyntheticSchedule& s, const std::vector<T>& theta,
+             const std::vector<double>& biovar,
+             const std::vector<double>& tlag) const {
+    return torsten::PKModelOneCpt(s.time, s.amt, s.rate, s.ii, s.evid,
+                                  s.cmt, s.addl, s.ss, theta, biovar, tlag);
+  }
+};
+
+struct TwoCpt {
+  static std::string Name() { return "PKModelTwoCpt"; }
+  static int NCmt() { return 3; }
+  static std::vector<double> Theta() {
+    double theta[] = {5, 8, 35, 105, 1.2};
+    return std::vector<double>(theta, theta + 5);
+  }
+  template <typename T>
+  Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>
+  operator()(const SyntheticSchedule& s, const std::vector<T>& theta,
+             const std::vector<double>& biovar,
+             const std::vector<double>& tlag) const {
+    return torsten::PKModelTwoCpt(s.time, s.amt, s.rate, s.ii, s.evid,
+                                  s.cmt, s.addl, s.ss, theta, biovar, tlag);
+  }
+};
+
+struct LinOde {
+  static std::string Name() { return "linOdeModel"; }
+  static int NCmt() { return 2; }
+  static std::vector<double> Theta() { return OneCpt::Theta(); }
+  template <typename T>
+  Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>
+  operator()(const SyntheticSchedule& s, const std::vector<T>& theta,
+             const std::vector<double>& biovar,
+             const std::vector<double>& tlag) const {
+    Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic> K(2, 2);
+    K(0, 0) = -theta[2];
+    K(0, 1) = 0;
+    K(1, 0) = theta[2];
+    K(1, 1) = -theta[0] / theta[1];
+    return torsten::linOdeModel(s.time, s.amt, s.rate, s.ii, s.evid,
+                                s.cmt, s.addl, s.ss, K, biovar, tlag);
+  }
+};
+
+struct GeneralRk45 {
+  static std::string Name() { return "generalOdeModel_rk45"; }
+  static int NCmt() { return 2; }
+  static std::vector<double> Theta() { return OneCpt::Theta(); }
+  template <typename T>
+  Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>
+  operator()(const SyntheticSchedule& s, const std::vector<T>& theta,
+             const std::vector<double>& biovar,
+             const std::vector<double>& tlag) const {
+    return torsten::generalOdeModel_rk45(oneCptODE(), NCmt(),
+                                         s.time, s.amt, s.rate, s.ii,
+                                         s.evid, s.cmt, s.addl, s.ss,
+                                         theta, biovar, tlag);
+  }
+};
+
+struct GeneralBdf {
+  static std::string Name() { return "generalOdeModel_bdf"; }
+  static int NCmt() { return 2; }
+  static std::vector<double> Theta() { return OneCpt::Theta(); }
+  template <typename T>
+  Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>
+  operator()(const SyntheticSchedule& s, const std::vector<T>& theta,
+             const std::vector<double>& biovar,
+             const std::vector<double>& tlag) const {
+    return torsten::generalOdeModel_bdf(oneCptODE(), NCmt(),
+                                        s.time, s.amt, s.rate, s.ii,
+                                        s.evid, s.cmt, s.addl, s.ss,
+                                        theta, biovar, tlag);
+  }
+};
+
+struct Mix1Rk45 {
+  static std::string Name() { return "mixOde1CptModel_rk45"; }
+  static int NCmt() { return 3; }
+  static std::vector<double> Theta() {
+    double theta[] = {10, 80, 1.2, 0.5};
+    return std::vector<double>(theta, theta + 4);
+  }
+  template <typename T>
+  Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>
+  operator()(const SyntheticSchedule& s, const std::vector<T>& theta,
+             const std::vector<double>& biovar,
+             const std::vector<double>& tlag) const {
+    return torsten::mixOde1CptModel_rk45(effectCptODE(), 1,
+                                         s.time, s.amt, s.rate, s.ii,
+                                         s.evid, s.cmt, s.addl, s.ss,
+                                         theta, biovar, tlag);
+  }
+};
+
+struct Mix1Bdf {
+  static std::string Name() { return "mixOde1CptModel_bdf"; }
+  static int NCmt() { return 3; }
+  static std::vector<double> Theta() { return Mix1Rk45::Theta(); }
+  template <typename T>
+  Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>
+  operator()(const SyntheticSchedule& s, const std::vector<T>& theta,
+             const std::vector<double>& biovar,
+             const std::vector<double>& tlag) const {
+    return torsten::mixOde1CptModel_bdf(effectCptODE(), 1,
+                                        s.time, s.amt, s.rate, s.ii,
+                                        s.evid, s.cmt, s.addl, s.ss,
+                                        theta, biovar, tlag);
+  }
+};
+
+struct Mix2Rk45 {
+  static std::string Name() { return "mixOde2CptModel_rk45"; }
+  static int NCmt() { return 4; }
+  static std::vector<double> Theta() {
+    double theta[] = {5, 8, 35, 105, 1.2, 0.5};
+    return std::vector<double>(theta, theta + 6);
+  }
+  template <typename T>
+  Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>
+  operator()(const SyntheticSchedule& s, const std::vector<T>& theta,
+             const std::vector<double>& biovar,
+             const std::vector<double>& tlag) const {
+    return torsten::mixOde2CptModel_rk45(effectCptODE(), 1,
+                                         s.time, s.amt, s.rate, s.ii,
+                                         s.evid, s.cmt, s.addl, s.ss,
+                                         theta, biovar, tlag);
+  }
+};
+
+struct Mix2Bdf {
+  static std::string Name() { return "mixOde2CptModel_bdf"; }
+  static int NCmt() { return 4; }
+  static std::vector<double> Theta() { return Mix2Rk45::Theta(); }
+  template <typename T>
+  Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>
+  operator()(const SyntheticSchedule& s, const std::vector<T>& theta,
+             const std::vector<double>& biovar,
+             const std::vector<double>& tlag) const {
+    return torsten::mixOde2CptModel_bdf(effectCptODE(), 1,
+                                        s.time, s.amt, s.rate, s.ii,
+                                        s.evid, s.cmt, s.addl, s.ss,
+                                        theta, biovar, tlag);
+  }
+};
+
+struct Options {
+  std::vector<std::string> models, designs;
+  std::vector<int> sizes;
+  double minTime;
+  std::string output;
+};
+
+std::vector<std::string> Split(const std::string& str) {
+  std::vector<std::string> items;
+  std::stringstream stream(str);
+  std::string item;
+  while (std::getline(stream, item, ','))
+    if (!item.empty()) items.push_back(item);
+  return items;
+}
+
+bool Selected(const std::vector<std::string>& list, const std::string& name) {
+  if (list.empty()) return true;
+  for (size_t i = 0; i < list.size(); i++)
+    if (list[i] == name) return true;
+  return false;
+}
+
+/**
+ * Calls f repeatedly until at least minTime seconds have elapsed,
+ * and returns the average time per call.
+ */
+template <typename F>
+double TimeCall(const F& f, double minTime, int& reps) {
+  typedef std::chrono::steady_clock clock;
+  double elapsed = 0;
+  reps = 0;
+  clock::time_point start = clock::now();
+  do {
+    f();
+    reps++;
+    elapsed = std::chrono::duration<double>(clock::now() - start).count();
+  } while (elapsed < minTime);
+  return elapsed / reps;
+}
+
+template <typename M>
+struct DoubleCall {
+  const M& model_;
+  const SyntheticSchedule& s_;
+  const std::vector<double>& theta_, &biovar_, &tlag_;
+  DoubleCall(const M& model, const SyntheticSchedule& s,
+             const std::vector<double>& theta,
+             const std::vector<double>& biovar,
+             const std::vector<double>& tlag)
+    : model_(model), s_(s), theta_(theta), biovar_(biovar), tlag_(tlag) { }
+  void operator()() const { model_(s_, theta_, biovar_, tlag_); }
+};
+
+template <typename M>
+struct GradientCall {
+  const M& model_;
+  const SyntheticSchedule& s_;
+  const std::vector<double>& theta_, &biovar_, &tlag_;
+  GradientCall(const M& model, const SyntheticSchedule& s,
+               const std::vector<double>& theta,
+               const std::vector<double>& biovar,
+               const std::vector<double>& tlag)
+    : model_(model), s_(s), theta_(theta), biovar_(biovar), tlag_(tlag) { }
+  void operator()() const {
+    using stan::math::var;
+    std::vector<var> theta(theta_.begin(), theta_.end());
+    Eigen::Matrix<var, Eigen::Dynamic, Eigen::Dynamic>
+      pred = model_(s_, theta, biovar_, tlag_);
+    var total = 0;
+    for (int i = 0; i < pred.size(); i++) total += pred(i);
+    total.grad();
+    stan::math::recover_memory();
+  }
+};
+
+template <typename M>
+void RunModel(const Options& options, std::ostream& out) {
+  M model;
+  if (!Selected(options.models, M::Name())) return;
+
+  std::vector<std::string> designs = SyntheticDesigns();
+  for (size_t d = 0; d < designs.size(); d++) {
+    if (!Selected(options.designs, designs[d])) continue;
+    for (size_t n = 0; n < options.sizes.size(); n++) {
+      SyntheticSchedule s = MakeSyntheticSchedule(designs[d],
+                                                  options.sizes[n], 1,
+                                                  M::NCmt());
+      std::vector<double> theta = M::Theta(),
+        biovar(M::NCmt(), 1), tlag(M::NCmt(), 0);
+      tlag[0] = s.tlag;
+
+      int reps;
+      double t_dbl = TimeCall(DoubleCall<M>(model, s, theta, biovar, tlag),
+                              options.minTime, reps);
+      out << M::Name() << "," << designs[d] << "," << s.size()
+          << ",double," << reps << "," << t_dbl << std::endl;
+
+      double t_var = TimeCall(GradientCall<M>(model, s, theta, biovar, tlag),
+                              options.minTime, reps);
+      out << M::Name() << "," << designs[d] << "," << s.size()
+          << ",var_gradient," << reps << "," << t_var << std::endl;
+    }
+  }
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  Options options;
+  options.minTime = 0.2;
+  int defaultSizes[] = {10, 100, 1000, 10000, 100000};
+  options.sizes.assign(defaultSizes, defaultSizes + 5);
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg(argv[i]);
+    size_t eq = arg.find('=');
+    std::string key = arg.substr(0, eq),
+      value = (eq == std::string::npos) ? "" : arg.substr(eq + 1);
+    if (key == "--models") {
+      options.models = Split(value);
+    } else if (key == "--designs") {
+      options.designs = Split(value);
+    } else if (key == "--sizes") {
+      std::vector<std::string> sizes = Split(value);
+      options.sizes.clear();
+      for (size_t j = 0; j < sizes.size(); j++)
+        options.sizes.push_back(std::atoi(sizes[j].c_str()));
+    } else if (key == "--min-time") {
+      options.minTime = std::atof(value.c_str());
+    } else if (key == "--output") {
+      options.output = value;
+    } else {
+      std::cerr << "unknown option: " << arg << std::endl;
+      return 1;
+    }
+  }
+
+  std::ofstream file;
+  if (!options.output.empty()) file.open(options.output.c_str());
+  std::ostream& out = options.output.empty() ? std::cout : file;
+
+  out << "model,design,n_events,scalar,reps,seconds_per_call" << std::endl;
+  RunModel<OneCpt>(options, out);
+  RunModel<TwoCpt>(options, out);
+  RunModel<LinOde>(options, out);
+  RunModel<GeneralRk45>(options, out);
+  RunModel<GeneralBdf>(options, out);
+  RunModel<Mix1Rk45>(options, out);
+  RunModel<Mix1Bdf>(options, out);
+  RunModel<Mix2Rk45>(options, out);
+  RunModel<Mix2Bdf>(options, out);
+
+  return 0;
+}
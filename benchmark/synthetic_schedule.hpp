@@ -0,0 +1,145 @@
+#ifndef STAN_MATH_TORSTEN_BENCHMARK_SYNTHETIC_SCHEDULE_HPP
+#define STAN_MATH_TORSTEN_BENCHMARK_SYNTHETIC_SCHEDULE_HPP
+
+#include <stan/math/prim/scal/err/invalid_argument.hpp>
+#include <string>
+#include <vector>
+
+namespace torsten {
+namespace benchmark {
+
+/**
+ * Event schedule following NONMEM conventions, stored as the
+ * columns Torsten functions take as arguments.
+ *
+ * Members:
+ *  time, amt, rate, ii, evid, cmt, addl, ss: NONMEM data items
+ *  tlag lag time in the dosing compartment (0 if no lag)
+ *  design name of the dosing design used to generate the schedule
+ */
+struct SyntheticSchedule {
+  std::vector<double> time, amt, rate, ii;
+  std::vector<int> evid, cmt, addl, ss;
+  double tlag;
+  std::string design;
+
+  SyntheticSchedule() : tlag(0) { }
+
+  int size() const { return time.size(); }
+
+  void AddRow(double p_time, double p_amt, double p_rate, double p_ii,
+              int p_evid, int p_cmt, int p_addl, int p_ss) {
+    time.push_back(p_time);
+    amt.push_back(p_amt);
+    rate.push_back(p_rate);
+    ii.push_back(p_ii);
+    evid.push_back(p_evid);
+    cmt.push_back(p_cmt);
+    addl.push_back(p_addl);
+    ss.push_back(p_ss);
+  }
+};
+
+/**
+ * Names of the dosing designs MakeSyntheticSchedule knows about.
+ */
+inline std::vector<std::string> SyntheticDesigns() {
+  std::vector<std::string> designs;
+  designs.push_back("bolus");
+  designs.push_back("infusion");
+  designs.push_back("addl");
+  designs.push_back("ss1");
+  designs.push_back("ss2");
+  designs.push_back("lag");
+  designs.push_back("reset");
+  designs.push_back("jitter");
+  return designs;
+}
+
+/**
+ * Generates a synthetic dosing schedule with (approximately) nEvent
+ * rows. Doses are administered every ii = 12 time units in the
+ * dosing compartment, and each dosing interval contains five
+ * observations, so that one interval spans six rows.
+ *
+ * Designs:
+ *   bolus     repeated bolus doses
+ *   infusion  repeated truncated infusions (duration 2)
+ *   addl      a single dosing row with addl covering the whole schedule
+ *   ss1       bolus doses, every fourth one is a steady state dose
+ *             with reset (ss = 1)
+ *   ss2       bolus doses, every fourth one is a steady state dose
+ *             without reset (ss = 2)
+ *   lag       bolus doses with a lag time of 0.5 in the dosing compartment
+ *   reset     bolus doses, every fourth interval starts with a reset
+ *             event (evid = 3)
+ *   jitter    bolus doses, each followed by an observation 0.001 time
+ *             units (a few seconds, in hours) later, as when a sample
+ *             scheduled at the time of the dose is recorded just after
+ *             it; the other observations are as above
+ *
+ * @param[in] design name of the dosing design
+ * @param[in] nEvent number of rows in the schedule
+ * @param[in] doseCmt compartment in which doses are administered
+ * @param[in] obsCmt compartment recorded on observation rows
+ * @return synthetic schedule
+ */
+inline SyntheticSchedule
+MakeSyntheticSchedule(const std::string& design, int nEvent,
+                      int doseCmt, int obsCmt) {
+  static const char* function("MakeSyntheticSchedule");
+  if (nEvent < 1)
+    stan::math::invalid_argument(function, "number of events", nEvent,
+                                 "is ", ", but must be positive!");
+
+  const double ii = 12, amt = 1000, duration = 2;
+  const double obsTimes[] = {0.5, 1, 2, 4, 8};
+  const int nObs = 5;
+
+  SyntheticSchedule schedule;
+  schedule.design = design;
+  if (design == "lag") schedule.tlag = 0.5;
+
+  int nInterval = (nEvent + nObs) / (nObs + 1);
+  if (nInterval < 1) nInterval = 1;
+
+  for (int i = 0; i < nInterval && schedule.size() < nEvent; i++) {
+    double t0 = i * ii;
+
+    if (design == "reset" && i > 0 && i % 4 == 0) {
+      schedule.AddRow(t0, 0, 0, 0, 3, doseCmt, 0, 0);
+      if (schedule.size() == nEvent) break;
+    }
+
+    if (design == "addl") {
+      if (i == 0)
+        schedule.AddRow(t0, amt, 0, ii, 1, doseCmt, nInterval - 1, 0);
+    } else if (design == "infusion") {
+      schedule.AddRow(t0, amt, amt / duration, 0, 1, doseCmt, 0, 0);
+    } else if (design == "ss1" && i % 4 == 0) {
+      schedule.AddRow(t0, amt, 0, ii, 1, doseCmt, 0, 1);
+    } else if (design == "ss2" && i % 4 == 0) {
+      schedule.AddRow(t0, amt, 0, ii, 1, doseCmt, 0, 2);
+    } else if (design == "bolus" || design == "lag" || design == "reset"
+               || design == "ss1" || design == "ss2"
+               || design == "jitter") {
+      schedule.AddRow(t0, amt, 0, 0, 1, doseCmt, 0, 0);
+    } else {
+      stan::math::invalid_argument(function, "design", design,
+                                   "is ", ", which is not a known design!");
+    }
+
+    for (int j = 0; j < nObs && schedule.size() < nEvent; j++) {
+      double t = (design == "jitter" && j == 0) ? t0 + 0.001
+        : t0 + obsTimes[j];
+      schedule.AddRow(t, 0, 0, 0, 0, obsCmt, 0, 0);
+    }
+  }
+
+  return schedule;
+}
+
+}  // benchmark namespace
+}  // torsten namespace
+
+#endif
@@ -0,0 +1,238 @@
+/**
+ * Gradients of the mixed solver models with respect to the event
+ * and lag times.
+ *
+ * Runs mixOde1CptModel or mixOde2CptModel (rk45) with an effect
+ * compartment (effectCptODE) on a synthetic event schedule, with the
+ * event times and the lag time of the dosing compartment as
+ * autodiff variables. The gradient of the sum of the predictions
+ * with respect to these times is compared with
+ *  - the same gradient computed by generalOdeModel_rk45 on the full
+ *    system of ODEs (oneCptEffectODE or twoCptEffectODE), and
+ *  - central finite differences of the mixed solver model.
+ *
+ * Writes one CSV row per time with the three gradients and the
+ * maximal relative difference of the mixed solver gradient to the
+ * other two, and exits with status 1 if it exceeds --max-error for
+ * some time.
+ *
+ * Options (all optional):
+ *   --model=mix1|mix2
+ *   --design=bolus (see MakeSyntheticSchedule)
+ *   --size=24               number of rows in the event schedule
+ *   --tlag=0.25             lag time in the dosing compartment
+ *   --tol=1e-12             rel_tol and abs_tol of the solvers
+ *   --step=1e-4             step of the finite differences
+ *   --max-error=1e-4
+ *   --output=file           write the results to file instead of stdout
+ */
+#include <stan/math/rev/mat.hpp>
+#include <stan/math/torsten/torsten.hpp>
+#include <stan/math/torsten/benchmark/synthetic_schedule.hpp>
+#include <stan/math/torsten/benchmark/ode_systems.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using torsten::benchmark::SyntheticSchedule;
+using torsten::benchmark::MakeSyntheticSchedule;
+using torsten::benchmark::effectCptODE;
+using torsten::benchmark::oneCptEffectODE;
+using torsten::benchmark::twoCptEffectODE;
+
+struct Setting {
+  std::string model;
+  bool general;  // full system solved by generalOdeModel_rk45
+  double tol;
+};
+
+int NCmt(const std::string& model) { return model == "mix2" ? 4 : 3; }
+
+std::vector<double> Theta(const std::string& model) {
+  std::vector<double> theta;
+  if (model == "mix2") {
+    double p[] = {5, 8, 35, 105, 1.2, 0.5};
+    theta.assign(p, p + 6);
+  } else {
+    double p[] = {10, 80, 1.2, 0.5};
+    theta.assign(p, p + 4);
+  }
+  return theta;
+}
+
+template <typename T>
+Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>
+Run(const Setting& c, const SyntheticSchedule& s,
+    const std::vector<T>& time, const std::vector<T>& tlag) {
+  int nCmt = NCmt(c.model);
+  std::vector<double> theta = Theta(c.model), biovar(nCmt, 1);
+  long int max_num_steps = 1e8;  // NOLINT(runtime/int)
+
+  if (c.general && c.model == "mix2")
+    return torsten::generalOdeModel_rk45(twoCptEffectODE(), nCmt, time,
+                                         s.amt, s.rate, s.ii, s.evid, s.cmt,
+                                         s.addl, s.ss, theta, biovar, tlag,
+                                         0, c.tol, c.tol, max_num_steps);
+  if (c.general)
+    return torsten::generalOdeModel_rk45(oneCptEffectODE(), nCmt, time,
+                                         s.amt, s.rate, s.ii, s.evid, s.cmt,
+                                         s.addl, s.ss, theta, biovar, tlag,
+                                         0, c.tol, c.tol, max_num_steps);
+  if (c.model == "mix2")
+    return torsten::mixOde2CptModel_rk45(effectCptODE(), 1, time, s.amt,
+                                         s.rate, s.ii, s.evid, s.cmt, s.addl,
+                                         s.ss, theta, biovar, tlag, 0,
+                                         c.tol, c.tol, max_num_steps);
+  return torsten::mixOde1CptModel_rk45(effectCptODE(), 1, time, s.amt,
+                                       s.rate, s.ii, s.evid, s.cmt, s.addl,
+                                       s.ss, theta, biovar, tlag, 0,
+                                       c.tol, c.tol, max_num_steps);
+}
+
+std::vector<double> LagTimes(const Setting& c, double tlag) {
+  std::vector<double> lag(NCmt(c.model), 0);
+  lag[0] = tlag;
+  return lag;
+}
+
+/**
+ * Sum of the predictions.
+ */
+double Total(const Setting& c, const SyntheticSchedule& s, double tlag) {
+  Eigen::MatrixXd pred = Run(c, s, s.time, LagTimes(c, tlag));
+  return pred.sum();
+}
+
+/**
+ * Gradient of the sum of the predictions with respect to the event
+ * times, followed by the lag time of the dosing compartment.
+ */
+std::vector<double> Gradient(const Setting& c, const SyntheticSchedule& s,
+                             double tlag_dbl) {
+  using stan::math::var;
+  std::vector<double> gradient;
+  try {
+    std::vector<var> time(s.time.begin(), s.time.end());
+    std::vector<double> lag = LagTimes(c, tlag_dbl);
+    std::vector<var> tlag(lag.begin(), lag.end());
+    Eigen::Matrix<var, Eigen::Dynamic, Eigen::Dynamic>
+      pred = Run(c, s, time, tlag);
+    var total = 0;
+    for (int i = 0; i < pred.size(); i++) total += pred(i);
+    total.grad();
+    for (size_t i = 0; i < time.size(); i++)
+      gradient.push_back(time[i].adj());
+    gradient.push_back(tlag[0].adj());
+  } catch (...) {
+    stan::math::recover_memory();
+    throw;
+  }
+  stan::math::recover_memory();
+  return gradient;
+}
+
+double RelativeError(double x, double ref, double scale) {
+  return std::fabs(x - ref) / std::max(std::fabs(ref), 1e-8 * scale);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  std::string model = "mix1", design = "bolus", output;
+  int size = 24;
+  double tlag = 0.25, tol = 1e-12, step = 1e-4, maxError = 1e-4;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg(argv[i]);
+    size_t eq = arg.find('=');
+    std::string key = arg.substr(0, eq),
+      value = (eq == std::string::npos) ? "" : arg.substr(eq + 1);
+    if (key == "--model") {
+      model = value;
+    } else if (key == "--design") {
+      design = value;
+    } else if (key == "--size") {
+      size = std::atoi(value.c_str());
+    } else if (key == "--tlag") {
+      tlag = std::atof(value.c_str());
+    } else if (key == "--tol") {
+      tol = std::atof(value.c_str());
+    } else if (key == "--step") {
+      step = std::atof(value.c_str());
+    } else if (key == "--max-error") {
+      maxError = std::atof(value.c_str());
+    } else if (key == "--output") {
+      output = value;
+    } else {
+      std::cerr << "unknown option: " << arg << std::endl;
+      return 1;
+    }
+  }
+  if (model != "mix1" && model != "mix2") {
+    std::cerr << "unknown model: " << model << std::endl;
+    return 1;
+  }
+
+  SyntheticSchedule s;
+  Setting mix, general;
+  mix.model = general.model = model;
+  mix.tol = general.tol = tol;
+  mix.general = false;
+  general.general = true;
+  std::vector<double> g_mix, g_general, g_fd;
+  try {
+    s = MakeSyntheticSchedule(design, size, 1, NCmt(model));
+    g_mix = Gradient(mix, s, tlag);
+    g_general = Gradient(general, s, tlag);
+    for (int i = 0; i <= s.size(); i++) {
+      SyntheticSchedule plus = s, minus = s;
+      double tlag_plus = tlag, tlag_minus = tlag;
+      if (i < s.size()) {
+        plus.time[i] += step;
+        minus.time[i] -= step;
+      } else {
+        tlag_plus += step;
+        tlag_minus -= step;
+      }
+      g_fd.push_back((Total(mix, plus, tlag_plus)
+                      - Total(mix, minus, tlag_minus)) / (2 * step));
+    }
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+
+  std::ofstream file;
+  if (!output.empty()) file.open(output.c_str());
+  std::ostream& out = output.empty() ? std::cout : file;
+
+  double scale = 0;
+  for (size_t i = 0; i < g_general.size(); i++)
+    scale = std::max(scale, std::fabs(g_general[i]));
+
+  bool ok = true;
+  out.precision(10);
+  out << "model,design,parameter,mix,general,finite_difference,error"
+      << std::endl;
+  for (size_t i = 0; i < g_mix.size(); i++) {
+    double error = std::max(RelativeError(g_mix[i], g_general[i], scale),
+                            RelativeError(g_mix[i], g_fd[i], scale));
+    if (!(error <= maxError)) ok = false;
+    out << model << "," << design << ",";
+    if (i + 1 < g_mix.size())
+      out << "time[" << i << "]";
+    else
+      out << "tlag";
+    out << "," << g_mix[i] << "," << g_general[i] << "," << g_fd[i] << ","
+        << error << std::endl;
+  }
+
+  return ok ? 0 : 1;
+}
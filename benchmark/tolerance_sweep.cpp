@@ -0,0 +1,392 @@
+/**
+ * Accuracy versus cost of the ODE based model functions.
+ *
+ * Runs one of the ODE based models (generalOdeModel, mixOde1CptModel
+ * or mixOde2CptModel) on a synthetic event schedule or on a subject
+ * of a NONMEM data set, for a grid of solvers (rk45, bdf) and
+ * tolerances. Predictions and gradients (of the sum of the
+ * predictions with respect to the ODE parameters) are compared with
+ * a reference solution computed at tight tolerances.
+ *
+ * A model of one's own is swept with generalOdeModel by compiling
+ * the tool with -DTORSTEN_SWEEP_ODE='"my_ode.hpp"', where my_ode.hpp
+ * defines the functor user_ode (right hand side of the ODE, with the
+ * signature of the functors of integrate_ode), and passing
+ * --model=user --ncmt=n --theta=....
+ *
+ * Writes one CSV row per setting with the average time per gradient
+ * evaluation and the maximal relative errors. Settings on the Pareto
+ * front of error against runtime (no other setting is both faster
+ * and more accurate) are flagged, so that the cheapest setting
+ * meeting an accuracy target can be read off the table.
+ *
+ * Options (all optional):
+ *   --model=general|mix1|mix2|user
+ *   --ncmt=n                number of compartments (--model=user)
+ *   --theta=p1,p2,...       ODE parameters (default: model dependent)
+ *   --data=file             NONMEM data set (see NonmemDataset)
+ *   --subject=0             index of the subject of the data set
+ *   --design=bolus (see MakeSyntheticSchedule), without --data
+ *   --size=100              number of rows in the event schedule
+ *   --solvers=rk45,bdf
+ *   --tols=1e-4,1e-6,1e-8,1e-10  used for both rel_tol and abs_tol
+ *   --max-num-steps=100000000
+ *   --reference-tol=1e-12   tolerance of the reference solution
+ *   --reference-solver=rk45 solver of the reference solution
+ *   --min-time=0.2          minimum time spent on each setting (seconds)
+ *   --output=file           write the results to file instead of stdout
+ */
+#include <stan/math/rev/mat.hpp>
+#include <stan/math/torsten/torsten.hpp>
+#include <stan/math/torsten/benchmark/synthetic_schedule.hpp>
+#include <stan/math/torsten/benchmark/ode_systems.hpp>
+#include <stan/math/torsten/PKModel/io/nonmem_dataset.hpp>
+#ifdef TORSTEN_SWEEP_ODE
+#include TORSTEN_SWEEP_ODE
+#endif
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using torsten::benchmark::SyntheticSchedule;
+using torsten::benchmark::MakeSyntheticSchedule;
+using torsten::benchmark::oneCptODE;
+using torsten::benchmark::effectCptODE;
+
+struct Setting {
+  std::string model, solver;
+  int nCmt;
+  double rel_tol, abs_tol;
+  long int max_num_steps;  // NOLINT(runtime/int)
+};
+
+int NCmt(const std::string& model) {
+  if (model == "mix1") return 3;
+  if (model == "mix2") return 4;
+  return 2;
+}
+
+std::vector<double> Theta(const std::string& model) {
+  std::vector<double> theta;
+  if (model == "mix2") {
+    double p[] = {5, 8, 35, 105, 1.2, 0.5};
+    theta.assign(p, p + 6);
+  } else if (model == "mix1") {
+    double p[] = {10, 80, 1.2, 0.5};
+    theta.assign(p, p + 4);
+  } else {
+    double p[] = {10, 80, 1.2};
+    theta.assign(p, p + 3);
+  }
+  return theta;
+}
+
+template <typename T>
+Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>
+Run(const Setting& c, const SyntheticSchedule& s,
+    const std::vector<T>& theta) {
+  int nCmt = c.nCmt;
+  std::vector<double> biovar(nCmt, 1), tlag(nCmt, 0);
+  tlag[0] = s.tlag;
+  bool bdf = (c.solver == "bdf");
+
+  if (c.model == "mix1") {
+    if (bdf)
+      return torsten::mixOde1CptModel_bdf(effectCptODE(), 1, s.time, s.amt,
+                                          s.rate, s.ii, s.evid, s.cmt, s.addl,
+                                          s.ss, theta, biovar, tlag, 0,
+                                          c.rel_tol, c.abs_tol,
+                                          c.max_num_steps);
+    return torsten::mixOde1CptModel_rk45(effectCptODE(), 1, s.time, s.amt,
+                                         s.rate, s.ii, s.evid, s.cmt, s.addl,
+                                         s.ss, theta, biovar, tlag, 0,
+                                         c.rel_tol, c.abs_tol,
+                                         c.max_num_steps);
+  } else if (c.model == "mix2") {
+    if (bdf)
+      return torsten::mixOde2CptModel_bdf(effectCptODE(), 1, s.time, s.amt,
+                                          s.rate, s.ii, s.evid, s.cmt, s.addl,
+                                          s.ss, theta, biovar, tlag, 0,
+                                          c.rel_tol, c.abs_tol,
+                                          c.max_num_steps);
+    return torsten::mixOde2CptModel_rk45(effectCptODE(), 1, s.time, s.amt,
+                                         s.rate, s.ii, s.evid, s.cmt, s.addl,
+                                         s.ss, theta, biovar, tlag, 0,
+                                         c.rel_tol, c.abs_tol,
+                                         c.max_num_steps);
+  }
+#ifdef TORSTEN_SWEEP_ODE
+  if (c.model == "user") {
+    if (bdf)
+      return torsten::generalOdeModel_bdf(user_ode(), nCmt, s.time, s.amt,
+                                          s.rate, s.ii, s.evid, s.cmt, s.addl,
+                                          s.ss, theta, biovar, tlag, 0,
+                                          c.rel_tol, c.abs_tol,
+                                          c.max_num_steps);
+    return torsten::generalOdeModel_rk45(user_ode(), nCmt, s.time, s.amt,
+                                         s.rate, s.ii, s.evid, s.cmt, s.addl,
+                                         s.ss, theta, biovar, tlag, 0,
+                                         c.rel_tol, c.abs_tol,
+                                         c.max_num_steps);
+  }
+#endif
+  if (bdf)
+    return torsten::generalOdeModel_bdf(oneCptODE(), nCmt, s.time, s.amt,
+                                        s.rate, s.ii, s.evid, s.cmt, s.addl,
+                                        s.ss, theta, biovar, tlag, 0,
+                                        c.rel_tol, c.abs_tol,
+                                        c.max_num_steps);
+  return torsten::generalOdeModel_rk45(oneCptODE(), nCmt, s.time, s.amt,
+                                       s.rate, s.ii, s.evid, s.cmt, s.addl,
+                                       s.ss, theta, biovar, tlag, 0,
+                                       c.rel_tol, c.abs_tol,
+                                       c.max_num_steps);
+}
+
+/**
+ * Predictions, and gradient of their sum with respect to theta.
+ */
+struct Solution {
+  std::vector<double> pred, gradient;
+};
+
+Solution Solve(const Setting& c, const SyntheticSchedule& s,
+               const std::vector<double>& theta_dbl) {
+  using stan::math::var;
+  Solution solution;
+  try {
+    std::vector<var> theta(theta_dbl.begin(), theta_dbl.end());
+    Eigen::Matrix<var, Eigen::Dynamic, Eigen::Dynamic>
+      pred = Run(c, s, theta);
+    var total = 0;
+    for (int i = 0; i < pred.size(); i++) {
+      solution.pred.push_back(pred(i).val());
+      total += pred(i);
+    }
+    total.grad();
+    for (size_t i = 0; i < theta.size(); i++)
+      solution.gradient.push_back(theta[i].adj());
+  } catch (...) {
+    stan::math::recover_memory();
+    throw;
+  }
+  stan::math::recover_memory();
+  return solution;
+}
+
+/**
+ * Maximal relative error, where the error of small values is
+ * measured relative to the largest reference value.
+ */
+double MaxError(const std::vector<double>& x,
+                const std::vector<double>& ref) {
+  double scale = 0, error = 0;
+  for (size_t i = 0; i < ref.size(); i++)
+    scale = std::max(scale, std::fabs(ref[i]));
+  double floor = 1e-8 * scale;
+  for (size_t i = 0; i < ref.size(); i++)
+    error = std::max(error, std::fabs(x[i] - ref[i])
+                              / std::max(std::fabs(ref[i]), floor));
+  return error;
+}
+
+struct Result {
+  Setting setting;
+  bool failed;
+  std::string message;
+  double seconds, pred_error, gradient_error;
+};
+
+std::vector<std::string> Split(const std::string& str) {
+  std::vector<std::string> items;
+  std::stringstream stream(str);
+  std::string item;
+  while (std::getline(stream, item, ','))
+    if (!item.empty()) items.push_back(item);
+  return items;
+}
+
+/**
+ * Event schedule of the i-th subject of a NONMEM data set.
+ */
+SyntheticSchedule ReadSubject(const std::string& path, int i) {
+  torsten::NonmemDataset dataset(path);
+  torsten::NonmemSubject subject = dataset.GetSubject(i);
+  SyntheticSchedule s;
+  s.time = subject.time;
+  s.amt = subject.amt;
+  s.rate = subject.rate;
+  s.ii = subject.ii;
+  s.evid = subject.evid;
+  s.cmt = subject.cmt;
+  s.addl = subject.addl;
+  s.ss = subject.ss;
+  s.design = "data";
+  return s;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  std::string model = "general", design = "bolus", output, data;
+  std::string reference_solver = "rk45";
+  int size = 100, nCmt = 0, subject = 0;
+  std::vector<double> theta;
+  std::vector<std::string> solvers = Split("rk45,bdf");
+  std::vector<std::string> tols = Split("1e-4,1e-6,1e-8,1e-10");
+  long int max_num_steps = 1e8;  // NOLINT(runtime/int)
+  double reference_tol = 1e-12, minTime = 0.2;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg(argv[i]);
+    size_t eq = arg.find('=');
+    std::string key = arg.substr(0, eq),
+      value = (eq == std::string::npos) ? "" : arg.substr(eq + 1);
+    if (key == "--model") {
+      model = value;
+    } else if (key == "--ncmt") {
+      nCmt = std::atoi(value.c_str());
+    } else if (key == "--theta") {
+      std::vector<std::string> items = Split(value);
+      theta.clear();
+      for (size_t k = 0; k < items.size(); k++)
+        theta.push_back(std::atof(items[k].c_str()));
+    } else if (key == "--data") {
+      data = value;
+    } else if (key == "--subject") {
+      subject = std::atoi(value.c_str());
+    } else if (key == "--design") {
+      design = value;
+    } else if (key == "--size") {
+      size = std::atoi(value.c_str());
+    } else if (key == "--solvers") {
+      solvers = Split(value);
+    } else if (key == "--tols") {
+      tols = Split(value);
+    } else if (key == "--max-num-steps") {
+      max_num_steps = std::atol(value.c_str());
+    } else if (key == "--reference-tol") {
+      reference_tol = std::atof(value.c_str());
+    } else if (key == "--reference-solver") {
+      reference_solver = value;
+    } else if (key == "--min-time") {
+      minTime = std::atof(value.c_str());
+    } else if (key == "--output") {
+      output = value;
+    } else {
+      std::cerr << "unknown option: " << arg << std::endl;
+      return 1;
+    }
+  }
+#ifdef TORSTEN_SWEEP_ODE
+  bool user = (model == "user");
+#else
+  bool user = false;
+#endif
+  if (model != "general" && model != "mix1" && model != "mix2" && !user) {
+    std::cerr << "unknown model: " << model << std::endl;
+    return 1;
+  }
+  if (user && (nCmt < 1 || theta.empty())) {
+    std::cerr << "--model=user needs --ncmt and --theta" << std::endl;
+    return 1;
+  }
+  if (!user) nCmt = NCmt(model);
+  if (theta.empty()) theta = Theta(model);
+
+  SyntheticSchedule s;
+  try {
+    if (data.empty()) {
+      s = MakeSyntheticSchedule(design, size, 1, nCmt);
+    } else {
+      s = ReadSubject(data, subject);
+      design = "data";
+    }
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+
+  Setting reference;
+  reference.model = model;
+  reference.nCmt = nCmt;
+  reference.solver = reference_solver;
+  reference.rel_tol = reference.abs_tol = reference_tol;
+  reference.max_num_steps = max_num_steps;
+  Solution ref = Solve(reference, s, theta);
+
+  std::vector<Result> results;
+  for (size_t i = 0; i < solvers.size(); i++) {
+    for (size_t j = 0; j < tols.size(); j++) {
+      Result r;
+      r.setting.model = model;
+      r.setting.nCmt = nCmt;
+      r.setting.solver = solvers[i];
+      r.setting.rel_tol = r.setting.abs_tol = std::atof(tols[j].c_str());
+      r.setting.max_num_steps = max_num_steps;
+      r.failed = false;
+      r.seconds = r.pred_error = r.gradient_error = 0;
+      try {
+        typedef std::chrono::steady_clock clock;
+        Solution sol;
+        int reps = 0;
+        double elapsed = 0;
+        clock::time_point start = clock::now();
+        do {
+          sol = Solve(r.setting, s, theta);
+          reps++;
+          elapsed
+            = std::chrono::duration<double>(clock::now() - start).count();
+        } while (elapsed < minTime);
+        r.seconds = elapsed / reps;
+        r.pred_error = MaxError(sol.pred, ref.pred);
+        r.gradient_error = MaxError(sol.gradient, ref.gradient);
+      } catch (const std::exception& e) {
+        r.failed = true;
+        r.message = e.what();
+      }
+      results.push_back(r);
+    }
+  }
+
+  std::ofstream file;
+  if (!output.empty()) file.open(output.c_str());
+  std::ostream& out = output.empty() ? std::cout : file;
+
+  out << "model,design,n_events,solver,rel_tol,abs_tol,seconds_per_call,"
+      << "pred_error,gradient_error,pareto" << std::endl;
+  for (size_t i = 0; i < results.size(); i++) {
+    const Result& r = results[i];
+    out << model << "," << design << "," << s.size() << ","
+        << r.setting.solver << "," << r.setting.rel_tol << ","
+        << r.setting.abs_tol << ",";
+    if (r.failed) {
+      out << "failed,,," << std::endl;
+      std::cerr << r.setting.solver << " " << r.setting.rel_tol << ": "
+                << r.message << std::endl;
+      continue;
+    }
+    double error = std::max(r.pred_error, r.gradient_error);
+    bool pareto = true;
+    for (size_t j = 0; j < results.size(); j++) {
+      const Result& q = results[j];
+      if (j == i || q.failed) continue;
+      double q_error = std::max(q.pred_error, q.gradient_error);
+      if (q.seconds <= r.seconds && q_error <= error
+          && (q.seconds < r.seconds || q_error < error))
+        pareto = false;
+    }
+    out << r.seconds << "," << r.pred_error << "," << r.gradient_error
+        << "," << (pareto ? 1 : 0) << std::endl;
+  }
+
+  return 0;
+}
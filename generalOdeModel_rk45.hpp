@@ -48,6 +48,9 @@ namespace torsten {
  * @param[in] abs_tol absolute tolerance for the Boost ode solver
  * @param[in] max_num_steps maximal number of steps to take within 
  *            the Boost ode solver 
+ * @param[in] auc_cmt compartments (starting at 1) whose AUC since
+ *            the first or last reset event is returned after the
+ *            amounts, in as many extra columns.
  * @return a matrix with predicted amount in each compartment 
  *         at each event. 
  *
@@ -76,7 +79,8 @@ generalOdeModel_rk45(const F& f,
                      std::ostream* msgs = 0,
                      double rel_tol = 1e-6,
                      double abs_tol = 1e-6,
-                     long int max_num_steps = 1e6) {  // NOLINT(runtime/int)
+                     long int max_num_steps = 1e6,  // NOLINT(runtime/int)
+                     const std::vector<int>& auc_cmt = std::vector<int>()) {
   using std::vector;
   using Eigen::Dynamic;
   using Eigen::Matrix;
@@ -84,6 +88,7 @@ generalOdeModel_rk45(const F& f,
 
   // check arguments
   static const char* function("generalOdeModel_rk45");
+  TORSTEN_TAPE_SCOPE(function);
   torsten::pmetricsCheck(time, amt, rate, ii, evid, cmt, addl, ss,
     pMatrix, biovar, tlag, function);
 
@@ -99,7 +104,8 @@ generalOdeModel_rk45(const F& f,
               Pred1_general<F0>(F0(f), rel_tol, abs_tol,
                             max_num_steps, msgs, "rk45"),
               PredSS_general<F0>(F0(f), rel_tol, abs_tol,
-                             max_num_steps, msgs, "rk45", nCmt));
+                             max_num_steps, msgs, "rk45", nCmt),
+              auc_cmt);
 }
 
 /**
@@ -345,5 +351,100 @@ generalOdeModel_rk45(const F& f,
                               msgs, rel_tol, abs_tol, max_num_steps);
 }
 
+/**
+ * Overload function for an event schedule compiled beforehand
+ * (see EventSchedule). The book-keeping of the event schedule is
+ * skipped, which saves time when the same schedule is used for
+ * many evaluations of the model.
+ *
+ * @tparam T4 type of scalars for the model parameters.
+ * @tparam T5 type of scalars for the bio-variability parameters.
+ * @tparam F type of ODE system function.
+ * @param[in] f functor for base ordinary differential equation
+ * @param[in] nCmt number of compartments in model
+ * @param[in] schedule compiled event schedule
+ * @param[in] pMatrix parameters at each event
+ * @param[in] biovar bio-variability at each event
+ * @param[in] rel_tol relative tolerance for the ode solver
+ * @param[in] abs_tol absolute tolerance for the ode solver
+ * @param[in] max_num_steps maximal number of steps to take within
+ *            the ode solver
+ * @param[in] sink if not null, receives the predictions at each
+ *            kept event, which are then not returned (see PredSink)
+ * @param[in] auc_cmt compartments (starting at 1) whose AUC is
+ *            returned after the amounts.
+ * @return a matrix with predicted amount in each compartment
+ *         at each event.
+ */
+template <typename T4, typename T5, typename F>
+Eigen::Matrix <typename boost::math::tools::promote_args<T4, T5>::type,
+  Eigen::Dynamic, Eigen::Dynamic>
+generalOdeModel_rk45(const F& f,
+                     const int nCmt,
+                     const EventSchedule& schedule,
+                     const std::vector<std::vector<T4> >& pMatrix,
+                     const std::vector<std::vector<T5> >& biovar,
+                     std::ostream* msgs = 0,
+                     double rel_tol = 1e-6,
+                     double abs_tol = 1e-6,
+                     long int max_num_steps = 1e6,  // NOLINT(runtime/int)
+                     PredSink* sink = 0,
+                     const std::vector<int>& auc_cmt = std::vector<int>()) {
+  using std::vector;
+  using Eigen::Dynamic;
+  using Eigen::Matrix;
+  using stan::math::invalid_argument;
+
+
+  static const char* function("generalOdeModel_rk45");
+  TORSTEN_TAPE_SCOPE(function);
+  schedule.CheckParameters(function, nCmt, pMatrix.size(),
+                           biovar.size());
+  if (!(pMatrix[0].size() > 0)) invalid_argument(function,
+    "the number of parameters per event is", pMatrix[0].size(),
+    "", " but must be greater than 0!");
+  if (!(biovar[0].size() > 0)) invalid_argument(function,
+    "the number of biovariability parameters per event is", biovar[0].size(),
+    "", " but must be greater than 0!");
+
+  // Construct dummy array of matrix for last argument of pred
+  Matrix<T4, Dynamic, Dynamic> dummy_system;
+  vector<Matrix<T4, Dynamic, Dynamic> > dummy_systems(1, dummy_system);
+
+  typedef general_functor<F> F0;
+
+  return Pred(schedule, pMatrix, biovar, nCmt, dummy_systems,
+              Pred1_general<F0>(F0(f), rel_tol, abs_tol, max_num_steps, msgs,
+                             "rk45"),
+              PredSS_general<F0>(F0(f), rel_tol, abs_tol, max_num_steps, msgs,
+                              "rk45", nCmt), sink,
+              auc_cmt);
+}
+
+/**
+ * Overload function for a compiled event schedule, with
+ * std::vector for pMatrix and biovar.
+ */
+template <typename T4, typename T5, typename F>
+Eigen::Matrix <typename boost::math::tools::promote_args<T4, T5>::type,
+  Eigen::Dynamic, Eigen::Dynamic>
+generalOdeModel_rk45(const F& f,
+                     const int nCmt,
+                     const EventSchedule& schedule,
+                     const std::vector<T4>& pMatrix,
+                     const std::vector<T5>& biovar,
+                     std::ostream* msgs = 0,
+                     double rel_tol = 1e-6,
+                     double abs_tol = 1e-6,
+                     long int max_num_steps = 1e6,  // NOLINT(runtime/int)
+                     PredSink* sink = 0,
+                     const std::vector<int>& auc_cmt = std::vector<int>()) {
+  std::vector<std::vector<T4> > vec_pMatrix(1, pMatrix);
+  std::vector<std::vector<T5> > vec_biovar(1, biovar);
+
+  return generalOdeModel_rk45(f, nCmt, schedule, vec_pMatrix, vec_biovar,
+                     msgs, rel_tol, abs_tol, max_num_steps, sink, auc_cmt);
+}
+
 }
 #endif
@@ -41,6 +41,9 @@ namespace torsten {
  * @param[in] system square matrix describing the linear system of ODEs
  * @param[in] bio-variability at each event
  * @param[in] lag times at each event
+ * @param[in] auc_cmt compartments (starting at 1) whose AUC since
+ *            the first or last reset event is returned after the
+ *            amounts, in as many extra columns.
  * @return a matrix with predicted amount in each compartment 
  * at each event.
  */
@@ -60,13 +63,15 @@ linOdeModel(const std::vector<T0>& time,
             const std::vector< Eigen::Matrix<T4, Eigen::Dynamic,
               Eigen::Dynamic> >& system,
             const std::vector<std::vector<T5> >& biovar,
-            const std::vector<std::vector<T6> >& tlag) {
+            const std::vector<std::vector<T6> >& tlag,
+            const std::vector<int>& auc_cmt = std::vector<int>()) {
   using std::vector;
   using Eigen::Dynamic;
   using Eigen::Matrix;
   using boost::math::tools::promote_args;
 
   static const char* function("linOdeModel");
+  TORSTEN_TAPE_SCOPE(function);
   for (size_t i = 0; i < system.size(); i++)
     stan::math::check_square(function, "system matrix", system[i]);
   int nCmt = system[0].cols();
@@ -78,7 +83,7 @@ linOdeModel(const std::vector<T0>& time,
 
   return Pred(time, amt, rate, ii, evid, cmt, addl, ss,
               pMatrix_dummy, biovar, tlag, nCmt, system,
-              Pred1_linOde(), PredSS_linOde());
+              Pred1_linOde(), PredSS_linOde(), auc_cmt);
 }
 
 /**
@@ -277,5 +282,69 @@ linOdeModel(const std::vector<T0>& time,
                      system, biovar, vec_tlag);
 }
 
+/**
+ * Overload function for an event schedule compiled beforehand
+ * (see EventSchedule). The book-keeping of the event schedule is
+ * skipped, which saves time when the same schedule is used for
+ * many evaluations of the model. The schedule must be compiled
+ * with the length of system as nSystem.
+ *
+ * @tparam T4 type of scalar for matrix describing linear ODE system.
+ * @tparam T5 type of scalars for bio-variability parameters.
+ * @param[in] schedule compiled event schedule
+ * @param[in] system square matrices describing the linear system of ODEs
+ * @param[in] biovar bio-variability at each event
+ * @param[in] sink if not null, receives the predictions at each
+ *            kept event, which are then not returned (see PredSink)
+ * @param[in] auc_cmt compartments (starting at 1) whose AUC is
+ *            returned after the amounts.
+ * @return a matrix with predicted amount in each compartment
+ * at each event.
+ */
+template <typename T4, typename T5>
+Eigen::Matrix <typename boost::math::tools::promote_args<T4, T5>::type,
+  Eigen::Dynamic, Eigen::Dynamic>
+linOdeModel(const EventSchedule& schedule,
+            const std::vector< Eigen::Matrix<T4, Eigen::Dynamic,
+              Eigen::Dynamic> >& system,
+            const std::vector<std::vector<T5> >& biovar,
+            PredSink* sink = 0,
+            const std::vector<int>& auc_cmt = std::vector<int>()) {
+  static const char* function("linOdeModel");
+  TORSTEN_TAPE_SCOPE(function);
+  for (size_t i = 0; i < system.size(); i++)
+    stan::math::check_square(function, "system matrix", system[i]);
+  int nCmt = system[0].cols();
+  schedule.CheckParameters(function, nCmt, 1, biovar.size(), system.size());
+  if (!(biovar[0].size() > 0)) stan::math::invalid_argument(function,
+    "the number of biovariability parameters per event is", biovar[0].size(),
+    "", " but must be greater than 0!");
+
+  std::vector<T4> parameters_dummy(0);
+  std::vector<std::vector<T4> > pMatrix_dummy(1, parameters_dummy);
+
+  return Pred(schedule, pMatrix_dummy, biovar, nCmt, system,
+              Pred1_linOde(), PredSS_linOde(), sink, auc_cmt);
+}
+
+/**
+ * Overload function for a compiled event schedule, with a matrix
+ * for system and a vector for biovar.
+ */
+template <typename T4, typename T5>
+Eigen::Matrix <typename boost::math::tools::promote_args<T4, T5>::type,
+  Eigen::Dynamic, Eigen::Dynamic>
+linOdeModel(const EventSchedule& schedule,
+            const Eigen::Matrix<T4, Eigen::Dynamic, Eigen::Dynamic>& system,
+            const std::vector<T5>& biovar,
+            PredSink* sink = 0,
+            const std::vector<int>& auc_cmt = std::vector<int>()) {
+  std::vector<Eigen::Matrix<T4, Eigen::Dynamic,
+                            Eigen::Dynamic> > vec_system(1, system);
+  std::vector<std::vector<T5> > vec_biovar(1, biovar);
+
+  return linOdeModel(schedule, vec_system, vec_biovar, sink, auc_cmt);
+}
+
 }
 #endif
@@ -30,7 +30,10 @@ namespace torsten {
  * @tparam T6 type of scalars for the model tlag parameters.
  * @tparam F type of ODE system function.
  * @param[in] f functor for base ordinary differential equation
- *            which gets solved numerically.
+ *            which gets solved numerically. Its time argument is the
+ *            time since the previous event, not the absolute time, so
+ *            that it cannot depend on the time of day; the gradients
+ *            with respect to the event and lag times rely on it.
  * @param[in] nOde number of ODEs we solve numerically.
  * @param[in] time times of events
  * @param[in] amt amount at each event
@@ -89,6 +92,7 @@ mixOde1CptModel_rk45(const F& f,
 
   // check arguments
   static const char* function("mixOde1CptModel_rk45");
+  TORSTEN_TAPE_SCOPE(function);
   torsten::pmetricsCheck(time, amt, rate, ii, evid, cmt, addl, ss,
                 theta, biovar, tlag, function);
 
@@ -350,5 +354,97 @@ mixOde1CptModel_rk45(const F& f,
                               msgs, rel_tol, abs_tol, max_num_steps);
 }
 
+/**
+ * Overload function for an event schedule compiled beforehand
+ * (see EventSchedule). The book-keeping of the event schedule is
+ * skipped, which saves time when the same schedule is used for
+ * many evaluations of the model.
+ *
+ * @tparam T4 type of scalars for the model parameters.
+ * @tparam T5 type of scalars for the bio-variability parameters.
+ * @tparam F type of ODE system function.
+ * @param[in] f functor for base ordinary differential equation
+ *            (its time argument is the time since the previous event)
+ * @param[in] nOde number of ODE states (in addition to the PK states)
+ * @param[in] schedule compiled event schedule
+ * @param[in] pMatrix parameters at each event
+ * @param[in] biovar bio-variability at each event
+ * @param[in] rel_tol relative tolerance for the ode solver
+ * @param[in] abs_tol absolute tolerance for the ode solver
+ * @param[in] max_num_steps maximal number of steps to take within
+ *            the ode solver
+ * @param[in] sink if not null, receives the predictions at each
+ *            kept event, which are then not returned (see PredSink)
+ * @return a matrix with predicted amount in each compartment
+ *         at each event.
+ */
+template <typename T4, typename T5, typename F>
+Eigen::Matrix <typename boost::math::tools::promote_args<T4, T5>::type,
+  Eigen::Dynamic, Eigen::Dynamic>
+mixOde1CptModel_rk45(const F& f,
+                     const int nOde,
+                     const EventSchedule& schedule,
+                     const std::vector<std::vector<T4> >& pMatrix,
+                     const std::vector<std::vector<T5> >& biovar,
+                     std::ostream* msgs = 0,
+                     double rel_tol = 1e-6,
+                     double abs_tol = 1e-6,
+                     long int max_num_steps = 1e6,  // NOLINT(runtime/int)
+                     PredSink* sink = 0) {
+  using std::vector;
+  using Eigen::Dynamic;
+  using Eigen::Matrix;
+  using stan::math::invalid_argument;
+
+  int nPK = 2;
+
+  static const char* function("mixOde1CptModel_rk45");
+  TORSTEN_TAPE_SCOPE(function);
+  schedule.CheckParameters(function, nPK + nOde, pMatrix.size(),
+                           biovar.size());
+  if (!(pMatrix[0].size() > 0)) invalid_argument(function,
+    "the number of parameters per event is", pMatrix[0].size(),
+    "", " but must be greater than 0!");
+  if (!(biovar[0].size() > 0)) invalid_argument(function,
+    "the number of biovariability parameters per event is", biovar[0].size(),
+    "", " but must be greater than 0!");
+
+  // Construct dummy array of matrix for last argument of pred
+  Matrix<T4, Dynamic, Dynamic> dummy_system;
+  vector<Matrix<T4, Dynamic, Dynamic> > dummy_systems(1, dummy_system);
+
+  typedef mix1_functor<F> F0;
+
+  return Pred(schedule, pMatrix, biovar, nPK + nOde, dummy_systems,
+              Pred1_mix1<F0>(F0(f), rel_tol, abs_tol, max_num_steps, msgs,
+                             "rk45"),
+              PredSS_mix1<F0>(F0(f), rel_tol, abs_tol, max_num_steps, msgs,
+                              "rk45", nOde), sink);
+}
+
+/**
+ * Overload function for a compiled event schedule, with
+ * std::vector for pMatrix and biovar.
+ */
+template <typename T4, typename T5, typename F>
+Eigen::Matrix <typename boost::math::tools::promote_args<T4, T5>::type,
+  Eigen::Dynamic, Eigen::Dynamic>
+mixOde1CptModel_rk45(const F& f,
+                     const int nOde,
+                     const EventSchedule& schedule,
+                     const std::vector<T4>& pMatrix,
+                     const std::vector<T5>& biovar,
+                     std::ostream* msgs = 0,
+                     double rel_tol = 1e-6,
+                     double abs_tol = 1e-6,
+                     long int max_num_steps = 1e6,  // NOLINT(runtime/int)
+                     PredSink* sink = 0) {
+  std::vector<std::vector<T4> > vec_pMatrix(1, pMatrix);
+  std::vector<std::vector<T5> > vec_biovar(1, biovar);
+
+  return mixOde1CptModel_rk45(f, nOde, schedule, vec_pMatrix, vec_biovar,
+                     msgs, rel_tol, abs_tol, max_num_steps, sink);
+}
+
 }
 #endif
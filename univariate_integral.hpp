@@ -6,32 +6,137 @@
 #include <stan/math/prim/arr/functor/integrate_ode_rk45.hpp>
 #include <stan/math/rev/mat/functor/integrate_ode_bdf.hpp>
 #include <stan/math/torsten/PKModel/SearchReal.hpp>
+#include <stan/math/torsten/PKModel/gauss_kronrod.hpp>
+#include <stan/math/prim/scal/err/invalid_argument.hpp>
 
 #include <vector>
 #include <algorithm>
 
-template<typename T0, typename Tl, typename Tr>
+namespace torsten {
+
+/**
+ * Integrand of univariate_integral_quad. Evaluates f at t and,
+ * using nested reverse mode, the derivatives of f with respect to
+ * the entries of theta which are parameters.
+ *
+ * As in the ODE based functions, f receives theta followed by
+ * the two integration limits.
+ */
+template <typename F>
+struct univariate_integrand {
+  const F& f_;
+  const std::vector<double>& theta_;
+  const std::vector<int>& index_;  // entries of theta which are parameters
+  const std::vector<double>& x_r_;
+  const std::vector<int>& x_i_;
+  std::ostream* msgs_;
+
+  univariate_integrand(const F& f, const std::vector<double>& theta,
+                       const std::vector<int>& index,
+                       const std::vector<double>& x_r,
+                       const std::vector<int>& x_i,
+                       std::ostream* msgs)
+    : f_(f), theta_(theta), index_(index), x_r_(x_r), x_i_(x_i),
+      msgs_(msgs) { }
+
+  void operator()(double t, std::vector<double>& values) const {
+    using stan::math::var;
+    if (index_.empty()) {
+      values[0] = f_(t, theta_, x_r_, x_i_, msgs_);
+      return;
+    }
+
+    stan::math::start_nested();
+    try {
+      std::vector<var> theta(theta_.begin(), theta_.end());
+      var fx = f_(t, theta, x_r_, x_i_, msgs_);
+      stan::math::grad(fx.vi_);
+      values[0] = fx.val();
+      for (size_t k = 0; k < index_.size(); k++)
+        values[k + 1] = theta[index_[k]].adj();
+    } catch (...) {
+      stan::math::recover_memory_nested();
+      throw;
+    }
+    stan::math::recover_memory_nested();
+  }
+};
+
+/**
+ * Adds x to the parameters of the ODE solved by
+ * univariate_integral_rk45/bdf if it is an autodiff variable, and to
+ * the data of partial_integrand_functor otherwise, and records where
+ * it went in layout.
+ */
+template <typename S>
+inline void split_parameter(double x, std::vector<S>& parameters,
+                            std::vector<int>& layout,
+                            std::vector<double>& data) {
+  layout.push_back(-static_cast<int>(data.size()) - 1);
+  data.push_back(x);
+}
+
+inline void split_parameter(const stan::math::var& x,
+                            std::vector<stan::math::var>& parameters,
+                            std::vector<int>& layout,
+                            std::vector<double>& data) {
+  layout.push_back(parameters.size());
+  parameters.push_back(x);
+}
+
+/**
+ * Splits theta and the integral limits into the parameters of the
+ * ODE solved by univariate_integral_rk45/bdf, which are the entries
+ * that are autodiff variables, and data. The sensitivity system of
+ * the ODE then only covers actual parameters.
+ */
+template <typename T0, typename Tl, typename Tr>
 inline
 std::vector<typename stan::return_type<Tl, Tr, T0>::type>
-theta_x(const std::vector<T0>& theta,
-          const Tl& t0, const Tr& t1){
-  std::vector<stan::math::var> res{stan::math::to_var(theta)};
-  res.push_back(stan::math::to_var(t0));
-  res.push_back(stan::math::to_var(t1));
-  return res;
+integral_parameters(const std::vector<T0>& theta, const Tl& t0,
+                    const Tr& t1, std::vector<int>& layout,
+                    std::vector<double>& data) {
+  std::vector<typename stan::return_type<Tl, Tr, T0>::type> parameters;
+  layout.clear();
+  data.clear();
+  for (size_t i = 0; i < theta.size(); i++)
+    split_parameter(theta[i], parameters, layout, data);
+  split_parameter(t0, parameters, layout, data);
+  split_parameter(t1, parameters, layout, data);
+  return parameters;
 }
 
-inline
-std::vector<double> theta_x(const std::vector<double>&
-                            theta,
-                            const double& t0,
-                            const double& t1){
-  std::vector<double> res{theta};
-  res.push_back(t0);
-  res.push_back(t1);
-  return res;
+inline void append_operand(const stan::math::var& x,
+                           std::vector<stan::math::var>& operands) {
+  operands.push_back(x);
+}
+
+inline void append_operand(double x,
+                           std::vector<stan::math::var>& operands) { }
+
+template <typename T>
+inline void append_operand(const std::vector<T>& x,
+                           std::vector<stan::math::var>& operands) {
+  for (size_t i = 0; i < x.size(); i++) append_operand(x[i], operands);
 }
 
+inline double integral_result(double value,
+                              const std::vector<stan::math::var>& operands,
+                              const std::vector<double>& gradients,
+                              const double*) {
+  return value;
+}
+
+inline stan::math::var
+integral_result(double value,
+                const std::vector<stan::math::var>& operands,
+                const std::vector<double>& gradients,
+                const stan::math::var*) {
+  return stan::math::precomputed_gradients(value, operands, gradients);
+}
+
+}  // torsten namespace
+
 namespace stan {
   namespace math {
 
@@ -44,7 +149,10 @@ namespace stan {
      * so that the seeked integral is
      * y(t1). To bypass the limit that t0 & t1 cannot be
      * parameters we put them in theta and perform a
-     * change-of-variable over the integrand.
+     * change-of-variable over the integrand. Only the entries of
+     * theta and of the limits which are autodiff variables are
+     * parameters of the ODE, so that its sensitivity system does
+     * not grow with the entries which are data.
      *
      * @tparam F Type of functor that is to be integrated.
      * @param f function that is to be integrated
@@ -66,16 +174,20 @@ namespace stan {
                              double relative_tolerance = 1e-10,
                             double absolute_tolerance = 1e-10,
                             int max_num_steps = 1E8) {
-      using stan::math::to_var;
       static const double t{0.0};
       static const std::vector<double> ts{1.0};
       static const std::vector<double> y0{0.0};
-      const normalized_integrand_functor<F> f{f0};
       using scalar = typename stan::return_type<T0,Tl,Tr>::type;
-      std::vector<scalar> par = theta_x(theta, t0, t1);
+      std::vector<int> layout;
+      std::vector<double> data;
+      std::vector<scalar> par = torsten::integral_parameters(theta, t0, t1,
+                                                             layout, data);
+      const partial_integrand_functor<F> f(f0, layout, data);
 
       std::vector<std::vector<scalar>> ode_res_vd =
-        stan::math::integrate_ode_bdf(f, y0, t, ts, par, x_r, x_i);
+        stan::math::integrate_ode_bdf(f, y0, t, ts, par, x_r, x_i, msgs,
+                                     relative_tolerance, absolute_tolerance,
+                                     max_num_steps);
 
       return ode_res_vd.back().back();
     }
@@ -89,7 +201,10 @@ namespace stan {
      * so that the seeked integral is
      * y(t1). To bypass the limit that t0 & t1 cannot be
      * parameters we put them in theta and perform a
-     * change-of-variable over the integrand.
+     * change-of-variable over the integrand. Only the entries of
+     * theta and of the limits which are autodiff variables are
+     * parameters of the ODE, so that its sensitivity system does
+     * not grow with the entries which are data.
      *
      * @tparam F Type of functor that is to be integrated.
      * @param f function that is to be integrated
@@ -111,21 +226,231 @@ namespace stan {
                             double relative_tolerance = 1e-6,
                             double absolute_tolerance = 1e-6,
                             int max_num_steps = 1E6) {
-      using stan::math::to_var;
       static const double t{0.0};
       static const std::vector<double> ts{1.0};
       static const std::vector<double> y0{0.0};
-      const normalized_integrand_functor<F> f{f0};
       using scalar = typename stan::return_type<T0,Tl,Tr>::type;
-      std::vector<scalar> par = theta_x(theta, t0, t1);
+      std::vector<int> layout;
+      std::vector<double> data;
+      std::vector<scalar> par = torsten::integral_parameters(theta, t0, t1,
+                                                             layout, data);
+      const partial_integrand_functor<F> f(f0, layout, data);
 
       std::vector<std::vector<scalar>> ode_res_vd =
-        stan::math::integrate_ode_rk45(f, y0, t, ts, par, x_r, x_i);
+        stan::math::integrate_ode_rk45(f, y0, t, ts, par, x_r, x_i, msgs,
+                                     relative_tolerance, absolute_tolerance,
+                                     max_num_steps);
 
       return ode_res_vd.back().back();
     }
 
 
+    /**
+     * Return the integral of a univariate function (provide
+     * in the form of functor) at specifed integration interval,
+     * computed by adaptive Gauss-Kronrod (7-15) quadrature.
+     *
+     * Takes the same arguments as univariate_integral_rk45, and f
+     * likewise receives theta followed by t0 and t1, but no ODE is
+     * solved. The gradients are computed directly: the derivatives
+     * with respect to theta are the integrals of the derivatives of
+     * f, which are integrated along with f, and the derivatives with
+     * respect to the limits follow from the fundamental theorem of
+     * calculus (f(t1) and -f(t0)).
+     *
+     * @tparam F Type of functor that is to be integrated.
+     * @param f function that is to be integrated
+     * @param t0 lower integral limit
+     * @param t1 upper integral limit
+     * @param theta parameters of f
+     * @param x_r real data of f
+     * @param x_i integer data of f
+     * @param msgs stream for messages of f
+     * @param relative_tolerance relative tolerance of the integral
+     * and of its gradient
+     * @param absolute_tolerance absolute tolerance of the integral
+     * and of its gradient
+     * @param max_num_steps maximal number of subintervals
+     * @return integral value.
+     */
+    template <typename F, typename Tl, typename Tr, typename T0>
+    inline
+    typename stan::return_type<Tl, Tr, T0>::type
+    univariate_integral_quad(const F &f0,    // integrand
+                             const Tl& t0,         // integral limit
+                             const Tr& t1,         // integral limit
+                             const std::vector<T0>& theta,
+                             const std::vector<double>& x_r,
+                             const std::vector<int>& x_i,
+                             std::ostream* msgs = 0,
+                             double relative_tolerance = 1e-6,
+                             double absolute_tolerance = 1e-6,
+                             int max_num_steps = 1E6) {
+      using scalar = typename stan::return_type<T0,Tl,Tr>::type;
+      const size_t n = theta.size();
+      std::vector<double> par = stan::math::value_of(theta);
+      par.push_back(stan::math::value_of(t0));
+      par.push_back(stan::math::value_of(t1));
+
+      // entries of par which are parameters, in the order of the
+      // operands of the result.
+      std::vector<int> index;
+      if (!stan::is_constant_struct<T0>::value)
+        for (size_t i = 0; i < n; i++) index.push_back(i);
+      if (!stan::is_constant_struct<Tl>::value) index.push_back(n);
+      if (!stan::is_constant_struct<Tr>::value) index.push_back(n + 1);
+
+      torsten::univariate_integrand<F> g(f0, par, index, x_r, x_i, msgs);
+      std::vector<double> integral;
+      torsten::gauss_kronrod_integrate(g, 1 + index.size(), par[n],
+                                       par[n + 1], relative_tolerance,
+                                       absolute_tolerance, max_num_steps,
+                                       integral);
+
+      std::vector<stan::math::var> operands;
+      torsten::append_operand(theta, operands);
+      torsten::append_operand(t0, operands);
+      torsten::append_operand(t1, operands);
+      std::vector<double> gradients(integral.begin() + 1, integral.end());
+      for (size_t k = 0; k < index.size(); k++) {
+        if (index[k] == static_cast<int>(n))
+          gradients[k] -= f0(par[n], par, x_r, x_i, msgs);
+        if (index[k] == static_cast<int>(n + 1))
+          gradients[k] += f0(par[n + 1], par, x_r, x_i, msgs);
+      }
+
+      return torsten::integral_result(integral[0], operands, gradients,
+                                      static_cast<scalar*>(0));
+    }
+
+
+    /**
+     * Return the integrals of a univariate function over a batch of
+     * intervals (t0[j], t1[j]), e.g. the dosing intervals of a
+     * subject, computed by adaptive Gauss-Kronrod (7-15) quadrature.
+     *
+     * The end points of all the intervals split the time axis into
+     * segments, each of which is integrated once, along with the
+     * derivatives of f with respect to theta, and the integral over
+     * an interval is the sum of the segments it covers. Overlapping
+     * intervals thus share the evaluations of f, and each integral is
+     * returned with precomputed gradients.
+     *
+     * Unlike univariate_integral_quad, f only receives theta (the
+     * limits differ from one interval to the other), so that it is
+     * the same function on every segment.
+     *
+     * @tparam F Type of functor that is to be integrated.
+     * @param f function that is to be integrated
+     * @param t0 lower integral limits
+     * @param t1 upper integral limits (t1[j] >= t0[j])
+     * @param theta parameters of f
+     * @param x_r real data of f
+     * @param x_i integer data of f
+     * @param msgs stream for messages of f
+     * @param relative_tolerance relative tolerance of the integral
+     * over each segment, and of its gradient
+     * @param absolute_tolerance absolute tolerance of the integral
+     * over each segment, and of its gradient
+     * @param max_num_steps maximal number of subintervals per segment
+     * @return integral over each interval.
+     */
+    template <typename F, typename Tl, typename Tr, typename T0>
+    inline
+    std::vector<typename stan::return_type<Tl, Tr, T0>::type>
+    univariate_integral_quad_batch(const F &f0,    // integrand
+                                   const std::vector<Tl>& t0,
+                                   const std::vector<Tr>& t1,
+                                   const std::vector<T0>& theta,
+                                   const std::vector<double>& x_r,
+                                   const std::vector<int>& x_i,
+                                   std::ostream* msgs = 0,
+                                   double relative_tolerance = 1e-6,
+                                   double absolute_tolerance = 1e-6,
+                                   int max_num_steps = 1E6) {
+      using scalar = typename stan::return_type<T0,Tl,Tr>::type;
+      using std::vector;
+      static const char* function("univariate_integral_quad_batch");
+      if (t0.size() != t1.size())
+        invalid_argument(function, "number of upper limits", t1.size(), "",
+                         " must equal the number of lower limits!");
+      check_finite(function, "lower limits", t0);
+      check_finite(function, "upper limits", t1);
+
+      const size_t m = t0.size(), n = theta.size();
+      vector<double> a = value_of(t0), b = value_of(t1),
+        par = value_of(theta);
+      for (size_t j = 0; j < m; j++)
+        if (b[j] < a[j])
+          invalid_argument(function, "upper limit", b[j], "",
+                           " must not be smaller than the lower limit!");
+
+      // segments between consecutive end points, and the number of
+      // intervals which cover each of them.
+      vector<double> points(a);
+      points.insert(points.end(), b.begin(), b.end());
+      std::sort(points.begin(), points.end());
+      points.erase(std::unique(points.begin(), points.end()), points.end());
+      vector<size_t> first(m), last(m);
+      vector<int> cover(points.size(), 0);
+      for (size_t j = 0; j < m; j++) {
+        first[j] = std::lower_bound(points.begin(), points.end(), a[j])
+          - points.begin();
+        last[j] = std::lower_bound(points.begin(), points.end(), b[j])
+          - points.begin();
+        cover[first[j]]++;
+        cover[last[j]]--;
+      }
+
+      vector<int> index;
+      if (!stan::is_constant_struct<T0>::value)
+        for (size_t i = 0; i < n; i++) index.push_back(i);
+      torsten::univariate_integrand<F> g(f0, par, index, x_r, x_i, msgs);
+      vector<vector<double> > segments(points.size());
+      int covered = 0;
+      for (size_t s = 0; s + 1 < points.size(); s++) {
+        covered += cover[s];
+        if (covered > 0)
+          torsten::gauss_kronrod_integrate(g, 1 + index.size(), points[s],
+                                           points[s + 1], relative_tolerance,
+                                           absolute_tolerance, max_num_steps,
+                                           segments[s]);
+      }
+
+      // values of f at the end points, for the derivatives with
+      // respect to the limits.
+      vector<double> f_points;
+      if (!stan::is_constant_struct<Tl>::value
+          || !stan::is_constant_struct<Tr>::value)
+        for (size_t s = 0; s < points.size(); s++)
+          f_points.push_back(f0(points[s], par, x_r, x_i, msgs));
+
+      vector<scalar> res;
+      res.reserve(m);
+      vector<double> integral;
+      for (size_t j = 0; j < m; j++) {
+        integral.assign(1 + index.size(), 0);
+        for (size_t s = first[j]; s < last[j]; s++)
+          for (size_t k = 0; k < integral.size(); k++)
+            integral[k] += segments[s][k];
+
+        vector<stan::math::var> operands;
+        torsten::append_operand(theta, operands);
+        vector<double> gradients(integral.begin() + 1, integral.end());
+        if (!stan::is_constant_struct<Tl>::value)
+          gradients.push_back(-f_points[first[j]]);
+        if (!stan::is_constant_struct<Tr>::value)
+          gradients.push_back(f_points[last[j]]);
+        torsten::append_operand(t0[j], operands);
+        torsten::append_operand(t1[j], operands);
+
+        res.push_back(torsten::integral_result(integral[0], operands,
+                                               gradients,
+                                               static_cast<scalar*>(0)));
+      }
+      return res;
+    }
+
 }
 }
 #endif